@@ -9,6 +9,11 @@
     @section  HISTORY
 
     v1.00 - First release
+    v1.10 - ENTTEC packets are parsed as bytes arrive, loop() does not wait for the host
+            DMX data is read directly into the output frame
+            Receive DMX on change (label 8) sends change of state packets (label 9)
+            Send RDM (label 7) and send RDM discovery (label 11) are bridged to SAMD51DMX
+            Received DMX is sent as soon as the host can take it, skipping to the latest frame
 */
 /**************************************************************************/
 
@@ -41,6 +46,7 @@
 
 uint8_t green_pin = 0;
 uint8_t mode = MODE_OUTPUT_DMX;
+uint8_t output_started = 0;
 int got_dmx = 0;
 uint8_t buffer[513];
 LXENTTECSerial eSerial = LXENTTECSerial();
@@ -51,7 +57,7 @@ void setup() {
   pinMode(RED_LED_PIN, OUTPUT);
   pinMode(GRN_LED_PIN, OUTPUT);           
   pinMode(BLU_LED_PIN, OUTPUT);
-  SAMDMX.setDirectionPin(RXTX_PIN); 
+  SAMD51DMX.setDirectionPin(RXTX_PIN); 
   Serial.begin(57600);//115200, etc.  probably doesn't matter because it changes to USB speed
 }
 
@@ -77,38 +83,54 @@ void gotDMXCallback(int slots) {
   got_dmx = slots;
 }
 
+void startOutput() {
+  if ( ! output_started ) {
+    SAMD51DMX.startRDM(RXTX_PIN, RDM_DIRECTION_OUTPUT);  // DMX output with RDM requests between frames
+    output_started = 1;
+  }
+}
+
 void doOutputMode() {
   uint8_t label = eSerial.readPacket();
-  if ( label == ENTTEC_LABEL_SEND_DMX ) {
-    int s = eSerial.numberOfSlots() + 1;		//add start code
-    for(int i=0; i<s; i++) {
-      SAMDMX.setSlot(i,eSerial.getSlot(i));
-    }
-    SAMDMX.startOutput();  //ignored if already started
+  if ( label == ENTTEC_LABEL_SEND_DMX ) {   // eSerial has committed the frame to SAMD51DMX
+    startOutput();
     setLED(GRN_LED_BIT);		//toggles green on and off
+  } else if ( ( label == ENTTEC_LABEL_SEND_RDM ) || ( label == ENTTEC_LABEL_SEND_RDM_DISCOVERY ) ) {
+    startOutput();              // eSerial has queued the request
   } else if ( label == ENTTEC_LABEL_RECEIVE_DMX ) {
-	SAMDMX.setDataReceivedCallback(&gotDMXCallback);
+	SAMD51DMX.setDataReceivedCallback(&gotDMXCallback);
 	mode = MODE_INPUT_DMX;
-	SAMDMX.startInput();
+	SAMD51DMX.stop();
+	output_started = 0;
+	SAMD51DMX.startInput();
 	setLED(BLU_LED_BIT);
-  } else if ( label == ENTTEC_LABEL_NONE ) {
+  } else if ( label == ENTTEC_LABEL_INVALID ) {
     setLED(RED_LED_BIT);
   }
+  if ( output_started ) {
+    eSerial.updateRDM();        // sends queued requests, writes responses as they arrive
+  }
 }
 
 void doInputMode() {
   if ( Serial.available()) {  //writing anything to the USB switched to output mode
-	SAMDMX.setDataReceivedCallback(0);
+	SAMD51DMX.setDataReceivedCallback(0);
 	mode = MODE_OUTPUT_DMX;
 	setLED(0);
     return;
   }
   if ( got_dmx ) {
-    int msg_size = got_dmx;
-	 eSerial.writeDMXPacket(SAMDMX.dmxData(), msg_size);
-    got_dmx = 0;
+    int msg_size = got_dmx + 1;   // slots plus start code
+    got_dmx = 0;                  // frames received while the host is busy are coalesced, the latest is sent next
+    // copy so that the slots sent all come from one frame
+    if ( SAMD51DMX.copyReceivedSlots(buffer, 0, msg_size) ) {
+      if ( eSerial.receiveOnChange() ) {
+        eSerial.writeDMXChanges(buffer, msg_size);
+      } else {
+        eSerial.writeDMXPacket(buffer, msg_size);
+      }
+    }
   }
-  delay(50);         // wait to allow serial to keep up
 }
 
 // ***************** main loop  ****************
@@ -15,12 +15,25 @@
 
 LXENTTECSerial::LXENTTECSerial ( void )
 {
-	//zero buffer including _dmx_data[0] which is start code
-    for (int n=0; n<DMX_MAX; n++) {
-    	_dmx_data[n] = 0;
-    }
-    
+    _dmx_data = NULL;
     _dmx_slots = 0;
+    
+    _state = ENTTEC_STATE_START;
+    _label = ENTTEC_LABEL_NONE;
+    _data_length = 0;
+    _data_index = 0;
+    _param = 0;
+    _receive_on_change = 0;
+    _host_valid = 0;
+    _rx_next = 0;
+    _rx_count = 0;
+    _rdm_head = 0;
+    _rdm_tail = 0;
+    _rdm_dest = NULL;
+    _rdm_busy = 0;
+    _dmx_packets = 0;
+    _rate_start_ms = 0;
+    _dmx_rate = 0;
 }
 
 LXENTTECSerial::~LXENTTECSerial ( void )
@@ -29,163 +42,335 @@ LXENTTECSerial::~LXENTTECSerial ( void )
 }
 
 //  ***** numberOfSlots() *****
-//  returns the number of DMX slots received
+//  returns the number of DMX slots in the last SEND_DMX packet
 //  returns 0 if no packet has been read or the last attempt returned an error
-//  a partial read of a corrupted packet will invalidate the buffer data
 
 int  LXENTTECSerial::numberOfSlots ( void ) {
 	return _dmx_slots;
 }
 
-//  ***** setNumberOfSlots(uint8_t value) *****
-//  standard DMX start code is zero
-
-void LXENTTECSerial::setNumberOfSlots ( int n ) {
-	_dmx_slots = n;
-}
-
-//  ***** getSlot(int slot) *****
-//  gets the value of a slot stored in the buffer
-//  slots are numbered 1 to 512
+//  ***** readPacket() *****
+//  parses whatever bytes are available from built-in Serial, does not wait for more
+//  returns the label of a packet when one is complete, ENTTEC_LABEL_NONE if none is
+//
+//    Bytes are read from Serial in chunks and a packet is assembled across calls,
+//    so call readPacket() as often as possible from loop().
+//    Packets with labels ENTTEC_LABEL_GET_INFO or ENTTEC_LABEL_GET_SERIAL
+//    are handled by writing a reply directly to the serial conection
+//    Packets with ENTTEC_LABEL_SEND_DMX labels have their dmx data read straight into
+//    SAMD51DMX's back buffer, which is committed for output if the packet is good
+//    Packets with ENTTEC_LABEL_SEND_RDM or ENTTEC_LABEL_SEND_RDM_DISCOVERY labels are queued
+//    to be sent by updateRDM()
+//    Packets with other labels have their data discarded, however their labels are retuned
+//    A packet without the 0xE7 end delimiter returns ENTTEC_LABEL_INVALID
+//
+//  Important:  must call Serial.begin(<baud>) before calling this method
 
-uint8_t LXENTTECSerial::getSlot ( int slot ) {
-	return _dmx_data[slot];
+uint8_t LXENTTECSerial::readPacket( void ) {
+   uint8_t label = parseBuffer();               // bytes left from last call
+   while ( label == ENTTEC_LABEL_NONE ) {
+      int n = Serial.available();
+      if ( n <= 0 ) {
+         break;
+      }
+      if ( ( _state == ENTTEC_STATE_DATA ) && ( _label == ENTTEC_LABEL_SEND_DMX ) && ( _data_index < DMX_MAX ) ) {
+         // dmx data goes directly from Serial to the output buffer
+         int remaining = ( ( _data_length < DMX_MAX ) ? _data_length : DMX_MAX ) - _data_index;
+         if ( n > remaining ) {
+            n = remaining;
+         }
+         _data_index += Serial.readBytes((char*)&_dmx_data[_data_index], n);
+         if ( _data_index == _data_length ) {
+            _state = ENTTEC_STATE_END;
+         }
+         continue;
+      }
+      if ( n > ENTTEC_READ_CHUNK ) {
+         n = ENTTEC_READ_CHUNK;
+      }
+      _rx_count = Serial.readBytes((char*)_rx_buffer, n);
+      _rx_next = 0;
+      label = parseBuffer();
+   }
+   return label;
 }
 
-//  ***** setSlot(int slot, uint8_t value) *****
-//  sets the value of a slot stored in the buffer
-//  slots are numbered 1 to 512
-
-void LXENTTECSerial::setSlot ( int slot, uint8_t value ) {
-	_dmx_data[slot] = value;
+//  ***** dmxPacketRate() *****
+//  returns ENTTEC_LABEL_SEND_DMX packets per second
+//  updated when called a second or more after the last update
+
+uint16_t LXENTTECSerial::dmxPacketRate( void ) {
+   uint32_t elapsed = millis() - _rate_start_ms;
+   if ( elapsed >= 1000 ) {
+      _dmx_rate = ( _dmx_packets * 1000 ) / elapsed;
+      _dmx_packets = 0;
+      _rate_start_ms += elapsed;
+   }
+   return _dmx_rate;
 }
 
-//  ***** startCode() *****
-//  returns the start code
-//  standard DMX start code is zero
-
-uint8_t LXENTTECSerial::startCode ( void ) {
-	return _dmx_data[0];
+//  ***** parseBuffer() *****
+//  advances the parser through the bytes in _rx_buffer
+//  stops at the end of a packet, leaving any remaining bytes for the next call
+
+uint8_t LXENTTECSerial::parseBuffer( void ) {
+   while ( _rx_next < _rx_count ) {
+      if ( _state == ENTTEC_STATE_DATA ) {      // take as much data as has arrived
+         uint16_t n = _rx_count - _rx_next;
+         if ( n > _data_length - _data_index ) {
+            n = _data_length - _data_index;
+         }
+         storeData(&_rx_buffer[_rx_next], n);
+         _rx_next += n;
+         _data_index += n;
+         if ( _data_index == _data_length ) {
+            _state = ENTTEC_STATE_END;
+         }
+         continue;
+      }
+      
+      uint8_t b = _rx_buffer[_rx_next++];
+      switch ( _state ) {
+         case ENTTEC_STATE_START:
+            if ( b == 0x7E ) {                  // packet start delimiter
+               _state = ENTTEC_STATE_LABEL;
+            }
+            break;
+         case ENTTEC_STATE_LABEL:
+            _label = b;
+            _state = ENTTEC_STATE_LENGTH_LSB;
+            break;
+         case ENTTEC_STATE_LENGTH_LSB:
+            _data_length = b;
+            _state = ENTTEC_STATE_LENGTH_MSB;
+            break;
+         case ENTTEC_STATE_LENGTH_MSB:
+            _data_length += (b << 8);
+            _data_index = 0;
+            _param = 0;
+            if ( _data_length > ENTTEC_MAX_DATA_LENGTH ) {
+               _state = ENTTEC_STATE_START;     // not a valid packet, look for the next start
+               return packetComplete(0);
+            }
+            if ( _label == ENTTEC_LABEL_SEND_DMX ) {
+               _dmx_data = SAMD51DMX.dmxBackBuffer();
+            } else if ( ( _label == ENTTEC_LABEL_SEND_RDM ) || ( _label == ENTTEC_LABEL_SEND_RDM_DISCOVERY ) ) {
+               uint8_t full = ( (uint8_t)(_rdm_head - _rdm_tail) >= ENTTEC_RDM_QUEUE_DEPTH );
+               if ( full || ( _data_length > RDM_MAX_FRAME ) ) {
+                  _rdm_dest = NULL;             // read and dropped, answered with a timeout
+               } else {
+                  _rdm_dest = _rdm_queue[_rdm_head & (ENTTEC_RDM_QUEUE_DEPTH-1)];
+               }
+            }
+            _state = _data_length ? ENTTEC_STATE_DATA : ENTTEC_STATE_END;
+            break;
+         case ENTTEC_STATE_END:
+            _state = ENTTEC_STATE_START;
+            return packetComplete( b == 0xE7 );
+      }
+   }
+   return ENTTEC_LABEL_NONE;
 }
 
-//  ***** setStartCode(uint8_t value) *****
-//  standard DMX start code is zero
-
-void LXENTTECSerial::setStartCode ( uint8_t value ) {
-	_dmx_data[0] = value;
+//  ***** storeData() *****
+//  keeps the parts of the packet data that are used
+
+void LXENTTECSerial::storeData( uint8_t* data, uint16_t length ) {
+   if ( _label == ENTTEC_LABEL_SEND_DMX ) {
+      if ( _data_index < DMX_MAX ) {
+         uint16_t n = DMX_MAX - _data_index;
+         memcpy(&_dmx_data[_data_index], data, ( length < n ) ? length : n);
+      }
+   } else if ( ( _label == ENTTEC_LABEL_SEND_RDM ) || ( _label == ENTTEC_LABEL_SEND_RDM_DISCOVERY ) ) {
+      if ( _rdm_dest ) {
+         memcpy(&_rdm_dest[_data_index], data, length);
+      }
+   } else {                               // GET_INFO user data length, RECEIVE_DMX mode
+      for (uint16_t n=0; n<length; n++) {
+         if ( _data_index + n == 0 ) {
+            _param = data[n];
+         } else if ( _data_index + n == 1 ) {
+            _param += (data[n] << 8);
+         }
+      }
+   }
 }
 
-//  ***** dmxData() *****
-//  pointer to data buffer for direct access
+//  ***** packetComplete() *****
+//  acts on a packet once its end delimiter has been read
 
-uint8_t* LXENTTECSerial::dmxData( void ) {
-	return &_dmx_data[0];
+uint8_t LXENTTECSerial::packetComplete( uint8_t valid ) {
+   if ( ! valid ) {                               // bad packet
+      if ( _label == ENTTEC_LABEL_SEND_DMX ) {
+         _dmx_slots = 0;                          // not committed, the frame on the wire is unchanged
+      }
+      return ENTTEC_LABEL_INVALID;
+   }
+   
+   switch ( _label ) {
+      case ENTTEC_LABEL_SEND_DMX:
+         if ( _data_length < DMX_MIN ) {      // padding is zero, the back buffer holds an older frame
+            memset(&_dmx_data[_data_length], 0, DMX_MIN - _data_length);
+            _data_length = DMX_MIN;
+         } else if ( _data_length > DMX_MAX ) {
+            _data_length = DMX_MAX;
+         }
+         _dmx_slots = _data_length-1;            //data length includes start code
+         SAMD51DMX.commitDMXBackBuffer(_dmx_slots);
+         _dmx_packets++;
+         break;
+      case ENTTEC_LABEL_GET_INFO:
+         this->writeInfo(_param);
+         break;
+      case ENTTEC_LABEL_RECEIVE_DMX:
+         _receive_on_change = _param & 0x01;
+         _host_valid = 0;                       // next frame is sent complete
+         break;
+      case ENTTEC_LABEL_GET_SERIAL:
+         this->writeSerialNumber(0xffffffff);
+         break;
+      case ENTTEC_LABEL_SEND_RDM:
+      case ENTTEC_LABEL_SEND_RDM_DISCOVERY:
+         if ( _rdm_dest ) {
+            _rdm_queue_length[_rdm_head & (ENTTEC_RDM_QUEUE_DEPTH-1)] = _data_length;
+            _rdm_head++;                           // publish after data is complete
+         } else {
+            sendTxBuffer(ENTTEC_LABEL_RDM_TIMEOUT, 0);
+         }
+         break;
+   }
+   return _label;
 }
 
-//  ***** readPacket() *****
-//  reads a packet into the buffer using built-in Serial
-//  blocks until packet is read or fails
+//  ***** updateRDM() *****
+//  sends queued RDM requests and writes their responses to Serial, does not wait
+//  returns 1 if a response or timeout was written
 //
-//    Packets with labels ENTTEC_LABEL_GET_INFO or ENTTEC_LABEL_GET_SERIAL
-//    are handled by writing a reply directly to the serial conection
-//    Packets with ENTTEC_LABEL_SEND_DMX labels have their dmx data read into the buffer
-//    Packets with other labels have their data discarded, however their labels are retuned
+//    A response, or a discovery response, is written as a DMX Received packet
+//    containing the bytes received, the host checks them.  No response is written
+//    as an ENTTEC_LABEL_RDM_TIMEOUT packet.  DMX output continues between requests.
+//    Call updateRDM() as often as possible from loop().
 //
-//  Important:  must call Serial.begin(<baud>) before calling this method
-
-uint8_t LXENTTECSerial::readPacket( void ) {
-   uint8_t b;
-   uint8_t label = ENTTEC_LABEL_NONE;
-   int data_length;
-   uint8_t userlsb = 0;
-   uint8_t usermsb = 0;
+//  Important:  SAMD51DMX must be started with startRDM()
+
+uint8_t LXENTTECSerial::updateRDM( void ) {
+   uint8_t rv = 0;
+   if ( _rdm_busy ) {
+      uint8_t result = SAMD51DMX.rdmControllerPacketResult();
+      if ( result == RDM_RESULT_NONE ) {
+         return 0;                                // response window still open
+      }
+      if ( result == RDM_RESULT_TIMEOUT ) {
+         sendTxBuffer(ENTTEC_LABEL_RDM_TIMEOUT, 0);
+      } else {
+         writeDMXPacket(SAMD51DMX.receivedRDMData(), SAMD51DMX.receivedRDMLength());
+      }
+      _rdm_busy = 0;
+      rv = 1;
+   }
    
-   b = getNextByte();
-   if ( b == 0x7E ) {               // byte must be packet start delimiter 0x7E
-      label = getNextByte();        // 6 = Send DMX
-      data_length = getNextByte();  // LSB
-      b = getNextByte();            // MSB
-	   data_length += (b << 8);
-	   switch ( label ) {
-	      case ENTTEC_LABEL_SEND_DMX:
-	         for(int n=0; n<data_length; n++) {        // read data_length bytes
-	            b = getNextByte();
-	            if ( n < DMX_MAX ) {
-			         _dmx_data[n] = b;                   // store bytes in buffer 
-			      }
-	         }
-	         break;
-	      case ENTTEC_LABEL_GET_INFO:
-	         if ( data_length == 2 ) {					   // user data length is 2 bytes
-	            userlsb = getNextByte();
-	            usermsb = getNextByte();
-	            break;
-	         }
-	      default:
-	         for(int n=0; n<data_length; n++) {        // read data_length bytes
-	            b = getNextByte();                     // discard
-	         }
-	   } //switch
-	   
-
-	   b = getNextByte();
-	   if ( b == 0xE7 ) {						// good packet
-			switch ( label ) {
-				case ENTTEC_LABEL_SEND_DMX:
-					if ( data_length < DMX_MIN ) {
-						data_length = DMX_MIN;
-					} else if ( data_length > DMX_MAX ) {
-						data_length = DMX_MAX;
-					}
-				   _dmx_slots = data_length-1; //data length includes start code
-					break;
-				case ENTTEC_LABEL_GET_INFO:
-				   this->writeInfo(userlsb+(usermsb<<8));
-				   break;
-				case ENTTEC_LABEL_GET_SERIAL:
-				   this->writeSerialNumber(0xffffffff);
-				   break;
-			}
-	   } else {							          // bad packet					
-	      if ( label == ENTTEC_LABEL_SEND_DMX ) {
-	         _dmx_slots = 0;					 // buffer is not valid anymore
-	      }
-	      label = ENTTEC_LABEL_NONE;
-	   }
-   }      // good start delimiter
-
-	return label;
+   while ( ( ! _rdm_busy ) && ( _rdm_head != _rdm_tail ) ) {
+      uint8_t index = _rdm_tail & (ENTTEC_RDM_QUEUE_DEPTH-1);
+      _rdm_busy = SAMD51DMX.startRDMControllerPacket(_rdm_queue[index], _rdm_queue_length[index]);
+      _rdm_tail++;
+      if ( ! _rdm_busy ) {
+         sendTxBuffer(ENTTEC_LABEL_RDM_TIMEOUT, 0);   // not a valid RDM packet
+         rv = 1;
+      }
+   }
+   return rv;
 }
 
-//  ***** writeDMXPacket() *****
+//  ***** writeDMXPacket(buffer, length) *****
 //  writes a DMX Received packet to Serial
-//  sends the DMX data from the _dmx_data buffer
+//  sends the DMX data from an external buffer
+//  buffer must include start code
 //
 //  Important:  must call Serial.begin(<baud>) before calling this method
 
-void LXENTTECSerial::writeDMXPacket( void ) {
-   this->writeDMXPacket(_dmx_data, _dmx_slots+1);	//includes start code
+void LXENTTECSerial::writeDMXPacket( uint8_t *buffer, int length ) {
+	if ( length > DMX_MAX ) {
+		length = DMX_MAX;
+	}
+	_tx_buffer[4] = 0;						//status byte unused at present
+	memcpy(&_tx_buffer[5], buffer, length);
+	sendTxBuffer(ENTTEC_LABEL_RECEIVED_DMX, length + 1);
 }
 
-//  ***** writeDMXPacket(buffer, length) *****
-//  writes a DMX Received packet to Serial
-//  sends the DMX data from an external buffer
-//  buffer must include start code
+//  ***** receiveOnChange() *****
+//  returns 1 if the host has asked for changes only with ENTTEC_LABEL_RECEIVE_DMX
+
+uint8_t LXENTTECSerial::receiveOnChange( void ) {
+	return _receive_on_change;
+}
+
+//  ***** writeDMXChanges(buffer, length) *****
+//  writes the slots that differ from those last reported to the host
+//  as ENTTEC_LABEL_CHANGE_OF_STATE packets, each covering 40 slots from a multiple of 8
+//  buffer must include start code, which is slot 0 of the change of state packet
+//  the first frame after receive on change is set is written as a DMX Received packet
+//  returns the number of packets written
 //
 //  Important:  must call Serial.begin(<baud>) before calling this method
 
-void LXENTTECSerial::writeDMXPacket( uint8_t *buffer, int length ) {
-	int total_length = length + 1;
-	uint8_t header[5];
-	header[0] = 0x7E;
-	header[1] = ENTTEC_LABEL_RECEIVED_DMX;
-	header[2] = total_length & 0xff;
-	header[3] = total_length >> 8;
-	header[4] = 0;						//status byte unused at present
-	Serial.write(header,5);
-	Serial.write(buffer, length);
-	header[0] = 0xE7;
-	Serial.write(header,1);
+int LXENTTECSerial::writeDMXChanges( uint8_t *buffer, int length ) {
+	if ( length > DMX_MAX ) {
+		length = DMX_MAX;
+	}
+	if ( ! _host_valid ) {
+		memcpy(_host_data, buffer, length);
+		memset(&_host_data[length], 0, DMX_MAX-length);
+		_host_valid = 1;
+		writeDMXPacket(buffer, length);
+		return 1;
+	}
+	
+	// bitmap of changed slots, one byte per 8 slot block
+	memset(_changed, 0, sizeof(_changed));
+	for (int n=0; n<length; n++) {
+		if ( buffer[n] != _host_data[n] ) {
+			_changed[n>>3] |= 1 << (n & 7);
+			_host_data[n] = buffer[n];
+		}
+	}
+	
+	int packets = 0;
+	int block = 0;
+	uint8_t* packet = &_tx_buffer[4];
+	while ( block < (int)sizeof(_changed) ) {
+		if ( _changed[block] == 0 ) {          // unchanged blocks are skipped
+			block++;
+			continue;
+		}
+		packet[0] = block;                      // start changed byte number / 8
+		int pdl = 6;
+		for (int b=0; b<ENTTEC_COS_SLOTS/8; b++) {
+			uint8_t bits = ( block+b < (int)sizeof(_changed) ) ? _changed[block+b] : 0;
+			packet[1+b] = bits;
+			for (int n=0; n<8; n++) {
+				if ( bits & (1 << n) ) {
+					packet[pdl++] = buffer[((block+b)<<3) + n];
+				}
+			}
+		}
+		sendTxBuffer(ENTTEC_LABEL_CHANGE_OF_STATE, pdl);
+		packets++;
+		block += ENTTEC_COS_SLOTS/8;
+	}
+	return packets;
+}
+
+//  ***** sendTxBuffer(label, length) *****
+//  adds the header and end delimiter to packet data already in _tx_buffer[4]
+//  and writes the whole packet to Serial at once, so it is not split into extra USB transfers
+
+void LXENTTECSerial::sendTxBuffer( uint8_t label, int length ) {
+	_tx_buffer[0] = 0x7E;
+	_tx_buffer[1] = label;
+	_tx_buffer[2] = length & 0xff;
+	_tx_buffer[3] = length >> 8;
+	_tx_buffer[4+length] = 0xE7;
+	Serial.write(_tx_buffer, length+5);
 }
 
 //  ***** writeInfo(length) *****
@@ -195,50 +380,25 @@ void LXENTTECSerial::writeDMXPacket( uint8_t *buffer, int length ) {
 //  Important:  must call Serial.begin(<baud>) before calling this method
 
 void LXENTTECSerial::writeInfo( uint16_t length ) {
-	uint8_t header[9];
-	header[0] = 0x7E;
-	header[1] = ENTTEC_LABEL_GET_INFO;
-	header[2] = (length+5) & 0xff;
-	header[3] = (length+5) >> 8;
-	header[4] = 44;   // protocol version lsb
-	header[5] = 1;    // msb
-	header[6] = 9;    // DMX break x10.67 usecs (~99usec on Teensy2++)
-	header[7] = 1;    // MAB x10.67 usecs       (~13usec on Teensy2++)
-	header[8] = 0;    // output speed packets/sec 0=max
-	Serial.write(header,9);
-	header[0] = 0x00;
-	for(uint16_t n=0; n<length; n++) {
-	   Serial.write(header, 1);				// does not save user data, write as zeros
+	if ( length > ENTTEC_TX_BUFFER_SIZE-10 ) {
+		length = ENTTEC_TX_BUFFER_SIZE-10;
 	}
-	header[0] = 0xE7;
-	Serial.write(header,1);
+	_tx_buffer[4] = 44;   // protocol version lsb
+	_tx_buffer[5] = 1;    // msb
+	_tx_buffer[6] = 9;    // DMX break x10.67 usecs (~99usec on Teensy2++)
+	_tx_buffer[7] = 1;    // MAB x10.67 usecs       (~13usec on Teensy2++)
+	_tx_buffer[8] = 0;    // output speed packets/sec 0=max
+	memset(&_tx_buffer[9], 0, length);	// does not save user data, write as zeros
+	sendTxBuffer(ENTTEC_LABEL_GET_INFO, length+5);
 }
 
 //  ***** writeSerialNumber(serialNumber) *****
 //  writes serial number packet
 
 void LXENTTECSerial::writeSerialNumber( uint32_t sn ) {
-	uint8_t header[9];
-	header[0] = 0x7E;
-	header[1] = ENTTEC_LABEL_GET_SERIAL;
-	header[2] = 4;
-	header[3] = 0;
-	header[4] = sn & 0xff;
-	header[5] = ( sn >> 8 ) & 0xff;
-	header[6] = ( sn >> 16 ) & 0xff;
-	header[7] = ( sn >> 24 ) & 0xff;
-	header[8] = 0xE7;
-	Serial.write(header,9);
-}
-
-//  ***** getNextByte() *****
-//  blocks until byte is available on Serial connection
-//  
-
-uint8_t LXENTTECSerial::getNextByte( void ) {
-  while ( true ) {
-    if ( Serial.available()) {
-      return Serial.read();
-    }
-  }
+	_tx_buffer[4] = sn & 0xff;
+	_tx_buffer[5] = ( sn >> 8 ) & 0xff;
+	_tx_buffer[6] = ( sn >> 16 ) & 0xff;
+	_tx_buffer[7] = ( sn >> 24 ) & 0xff;
+	sendTxBuffer(ENTTEC_LABEL_GET_SERIAL, 4);
 }
@@ -8,6 +8,7 @@
 
 #include <Arduino.h>
 #include <inttypes.h>
+#include <LXSAMD51DMX.h>
 
 #define DMX_MIN 25
 #define DMX_MAX 513
@@ -16,8 +17,32 @@
 #define ENTTEC_LABEL_GET_INFO     3
 #define ENTTEC_LABEL_RECEIVED_DMX 5
 #define ENTTEC_LABEL_SEND_DMX     6
-#define ENTTEC_LABEL_RECEIVE_DMX  8
+#define ENTTEC_LABEL_SEND_RDM     7
+#define ENTTEC_LABEL_RECEIVE_DMX  8     // data 0 = send every frame, 1 = send changes only
+#define ENTTEC_LABEL_CHANGE_OF_STATE 9
 #define ENTTEC_LABEL_GET_SERIAL   10
+#define ENTTEC_LABEL_SEND_RDM_DISCOVERY 11
+#define ENTTEC_LABEL_RDM_TIMEOUT  12    // reply when no response was received
+#define ENTTEC_LABEL_INVALID      0xFF    // bad end delimiter or length, returned by readPacket
+
+// the API limits packet data to 600 bytes
+#define ENTTEC_MAX_DATA_LENGTH    600
+// bytes taken from Serial at one time
+#define ENTTEC_READ_CHUNK         64
+// slots covered by a change of state packet, starting at a multiple of 8
+#define ENTTEC_COS_SLOTS          40
+// largest packet written: header, status byte, start code plus 512 slots, end delimiter
+#define ENTTEC_TX_BUFFER_SIZE     (DMX_MAX+6)
+// RDM requests waiting to be sent, must be a power of two
+#define ENTTEC_RDM_QUEUE_DEPTH    4
+
+// packet parser states
+#define ENTTEC_STATE_START        0
+#define ENTTEC_STATE_LABEL        1
+#define ENTTEC_STATE_LENGTH_LSB   2
+#define ENTTEC_STATE_LENGTH_MSB   3
+#define ENTTEC_STATE_DATA         4
+#define ENTTEC_STATE_END          5
 
 class LXENTTECSerial {
 
@@ -26,24 +51,52 @@ class LXENTTECSerial {
    ~LXENTTECSerial ( void );
    
    int  numberOfSlots    ( void );
-   void setNumberOfSlots ( int n );
-   uint8_t  getSlot      ( int slot );
-   void     setSlot      ( int slot, uint8_t value );
-   uint8_t  startCode    ( void );
-   void  setStartCode    ( uint8_t value );
-   uint8_t* dmxData      ( void );
    
    uint8_t readPacket     ( void );
-   void    writeDMXPacket ( void );
+   uint16_t dmxPacketRate ( void );
    void    writeDMXPacket ( uint8_t *buffer, int length );
+   uint8_t receiveOnChange ( void );
+   int     writeDMXChanges ( uint8_t *buffer, int length );
    void    writeInfo      ( uint16_t length );
    void    writeSerialNumber ( uint32_t sn );
+   uint8_t updateRDM      ( void );
     
   private:
-  	uint8_t  _dmx_data[DMX_MAX];
+  	uint8_t* _dmx_data;       // SAMD51DMX back buffer while a SEND_DMX packet is read
   	int      _dmx_slots;
+  	
+  	uint8_t  _state;
+  	uint8_t  _label;
+  	uint16_t _data_length;
+  	uint16_t _data_index;
+  	uint16_t _param;          // first two bytes of packet data, lsb first
+  	
+  	uint8_t  _rx_buffer[ENTTEC_READ_CHUNK];
+  	uint8_t  _rx_next;
+  	uint8_t  _rx_count;
+  	
+  	uint8_t  _tx_buffer[ENTTEC_TX_BUFFER_SIZE];  // packets are built here and sent with one write
+  	
+  	uint8_t  _receive_on_change;
+  	uint8_t  _host_valid;
+  	uint8_t  _host_data[DMX_MAX];  // DMX input as last reported to the host
+  	uint8_t  _changed[(DMX_MAX+7)/8];
+  	
+  	uint8_t  _rdm_queue[ENTTEC_RDM_QUEUE_DEPTH][RDM_MAX_FRAME];
+  	uint16_t _rdm_queue_length[ENTTEC_RDM_QUEUE_DEPTH];
+  	uint8_t  _rdm_head;       // free running indexes, count is _rdm_head - _rdm_tail
+  	uint8_t  _rdm_tail;
+  	uint8_t* _rdm_dest;       // queue entry while a SEND_RDM packet is read, NULL if dropped
+  	uint8_t  _rdm_busy;
+  	
+  	uint32_t _dmx_packets;
+  	uint32_t _rate_start_ms;
+  	uint16_t _dmx_rate;
   	    
-  	uint8_t  getNextByte( void );
+  	uint8_t  parseBuffer( void );
+  	void     storeData( uint8_t* data, uint16_t length );
+  	uint8_t  packetComplete( uint8_t valid );
+  	void     sendTxBuffer( uint8_t label, int length );
 };
 
 #endif // ifndef LXENTTECSerial_H
\ No newline at end of file
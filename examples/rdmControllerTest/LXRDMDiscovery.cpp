@@ -34,6 +34,7 @@ void LXRDMDiscovery::updateRDMDiscovery() {
         // for this test, we just print the list of devices
          Serial.println("_______________ Table Of Devices _______________");
          tableOfDevices.printTOD();
+         printDeviceStats();
       }
     }
   } else {    // search for devices in range popped from discoveryTree
@@ -61,13 +62,7 @@ void LXRDMDiscovery::checkDeviceFound(UID* found) {
 
 
 uint8_t LXRDMDiscovery::testMute(UID* u) {
-   // try three times to get response when sending a mute message
-   if ( SAMD51DMX.sendRDMDiscoveryMute(u, RDM_DISC_MUTE) ) {
-     return RDM_MUTE_ACCEPT;
-   }
-   if ( SAMD51DMX.sendRDMDiscoveryMute(u, RDM_DISC_MUTE) ) {
-     return RDM_MUTE_ACCEPT;
-   }
+   // SAMD51DMX sends the mute message again if there is no response (see setRDMRetryPolicy)
    if ( SAMD51DMX.sendRDMDiscoveryMute(u, RDM_DISC_MUTE) ) {
      return RDM_MUTE_ACCEPT;
    }
@@ -86,6 +81,9 @@ uint8_t LXRDMDiscovery::checkTable(uint8_t ck_index) {
     
     // device not found
     tableOfDevices.removeUIDAt(ck_index);
+    if ( SAMD51DMX.rdmResponseCache() ) {   // forget its cached parameters
+      SAMD51DMX.rdmResponseCache()->invalidate(&deviceID);
+    }
     tableChangedFlag = 1;
     return ck_index;
   }
@@ -95,37 +93,93 @@ uint8_t LXRDMDiscovery::checkTable(uint8_t ck_index) {
 
 /*
  *  Send an identify message to each device in the tableOfDevices
+ *  Start addresses are read RDM_BATCH_SIZE devices at a time with a batch,
+ *  then each device that answered is identified in turn.
  */
 
 void LXRDMDiscovery::identifyEach() { // Send an identify command to each device in the table
   int i = 0;
-  uint8_t notDone = RDM_NOT_DONE;
-  while ( notDone ) {
-    i = tableOfDevices.getNextUID(i, &deviceID);
-    if ( i < 0 ) {
-      notDone = RDM_DONE;
-    } else {
-      //uint16_t data;  //for DMX address and identify device on/off
-      uint8_t data[2];
-      if ( SAMD51DMX.sendRDMGetCommand(&deviceID, RDM_DEVICE_START_ADDR, data, 2) ) {
+  while ( i >= 0 ) {
+    uint8_t n = 0;
+    while ( n < RDM_BATCH_SIZE ) {
+      i = tableOfDevices.getNextUID(i, &deviceID);
+      if ( i < 0 ) {
+        break;
+      }
+      setBatchRequest(n, RDM_GET_COMMAND, RDM_DEVICE_START_ADDR, 2);
+      n++;
+    }
+    if ( n == 0 ) {
+      break;
+    }
+
+    SAMD51DMX.sendRDMBatch(batch, n, NULL, &batchStats);
+    printBatchStats();
+
+    for (uint8_t j=0; j<n; j++) {
+      if ( batch[j].result == RDM_RESULT_ACK ) {
+        uint8_t* data = batchData[j];
         uint16_t addr = (data[0] << 8) | data[1];
 
         if ( addr == 0x0F ) {
           data[0] = 0x00;
           data[1] = 0x01;
-          SAMD51DMX.sendRDMSetCommand(&deviceID, RDM_DEVICE_START_ADDR, (uint8_t*)data, 2);
+          SAMD51DMX.sendRDMSetCommand(&batch[j].target, RDM_DEVICE_START_ADDR, data, 2);
         }
-  
+
         data[0] = 0x01;
-        SAMD51DMX.sendRDMSetCommand(&deviceID, RDM_IDENTIFY_DEVICE, (uint8_t*)data, 1);
+        SAMD51DMX.sendRDMSetCommand(&batch[j].target, RDM_IDENTIFY_DEVICE, data, 1);
         delay(2000);
         data[0] = 0x00;
-        SAMD51DMX.sendRDMSetCommand(&deviceID, RDM_IDENTIFY_DEVICE, (uint8_t*)data, 1);
+        SAMD51DMX.sendRDMSetCommand(&batch[j].target, RDM_IDENTIFY_DEVICE, data, 1);
       }
     }
   }
 }
 
+void LXRDMDiscovery::setBatchRequest(uint8_t index, uint8_t cmdclass, uint16_t pid, uint8_t len) {
+  batch[index].target = deviceID;
+  batch[index].pid = pid;
+  batch[index].subdevice = RDM_ROOT_DEVICE;
+  batch[index].cmdclass = cmdclass;
+  batch[index].data = batchData[index];
+  batch[index].len = len;
+}
+
+void LXRDMDiscovery::printBatchStats() {
+  Serial.print("batch of ");
+  Serial.print(batchStats.requests);
+  Serial.print(", acked ");
+  Serial.print(batchStats.acked);
+  Serial.print(", ");
+  Serial.print(batchStats.per_second);
+  Serial.println(" transactions/sec");
+}
+
+void LXRDMDiscovery::printDeviceStats() {
+  RDMDeviceStats* stats = SAMD51DMX.rdmDeviceStats();
+  if ( stats == NULL ) {
+    return;
+  }
+  for (uint8_t j=0; j<stats->count(); j++) {
+    const RDMDeviceStatsEntry* entry = stats->entry(j);
+    Serial.print(UID(entry->uid));
+    Serial.print(" sent ");
+    Serial.print(entry->requests);
+    Serial.print(" timeouts ");
+    Serial.print(entry->timeouts);
+    Serial.print(" bad ");
+    Serial.print(entry->checksum_failures + entry->mismatches);
+    Serial.print(" nacks ");
+    Serial.print(entry->nacks);
+    Serial.print(" latency ");
+    Serial.print(entry->latency_us);
+    Serial.print("us max ");
+    Serial.print(entry->max_latency_us);
+    Serial.println("us");
+  }
+}
+
 void LXRDMDiscovery::pushActiveBranch() {
   if ( mid.becomeMidpoint(lower, upper) ) {
     discoveryTree.push(lower);
@@ -14,6 +14,8 @@
 #include <rdm/rdm_utility.h>
 #include <rdm/UID.h>
 #include <rdm/TOD.h>
+#include <rdm/RDMResponseCache.h>
+#include <rdm/RDMDeviceStats.h>
 
 
 // Constants
@@ -32,6 +34,8 @@
 #define RDM_DONE      0
 #define RDM_NOT_DONE  1
 
+#define RDM_BATCH_SIZE 16
+
 /*************************************************** 
  *     RDM discovery functions
  *     
@@ -88,7 +92,7 @@ class LXRDMDiscovery {
 	
 	/*
 	 *  __testMute__
-	 *  Try three times to mute the device.
+	 *  Mute the device, retried by SAMD51DMX.
 	 *  Return RDM_MUTE_ACCEPT if mute is acknowledged,
 	 *  or RDM_MUTE_NOREPLY if not.
 	 */
@@ -110,6 +114,19 @@ class LXRDMDiscovery {
 	 */
 	void identifyEach();
 	
+	/*
+	 *  __setBatchRequest__
+	 *  Fill batch[index] with a request to deviceID
+	 */
+	void setBatchRequest(uint8_t index, uint8_t cmdclass, uint16_t pid, uint8_t len);
+	void printBatchStats();
+	
+	/*
+	 *  __printDeviceStats__
+	 *  Print the counts kept for each device, if SAMD51DMX has RDMDeviceStats
+	 */
+	void printDeviceStats();
+	
 	/*
 	 *  __pushActiveBranch__
 	 *  Called when range responded,
@@ -144,6 +161,10 @@ class LXRDMDiscovery {
 	UID upper{};
 	UID   mid{};
 
+  RDMBatchRequest batch[RDM_BATCH_SIZE];
+  uint8_t batchData[RDM_BATCH_SIZE][2];
+  RDMBatchStats batchStats;
+
   uint8_t identifyFlag = RDM_DONT_IDENTIFY;
   uint8_t tableChangedFlag = RDM_TABLE_UNCHANGED;
 	uint8_t discovery_state = RDM_DISC_STATE_TBL_CK;
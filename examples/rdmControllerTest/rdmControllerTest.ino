@@ -23,6 +23,9 @@
 uint8_t testLevel = 0;
 uint8_t loopDivider = 0;
 
+RDMResponseCache rdmCache;    // DEVICE_INFO, labels... are asked for once per device
+RDMDeviceStats rdmStats;      // timeouts, NACKs and latency of each device
+
 
 #define DIRECTION_PIN 2
 
@@ -44,6 +47,9 @@ void setup() {
   //pinMode(8, OUTPUT);
   //digitalWrite(8, LOW);
   
+  SAMD51DMX.setRDMResponseCache(&rdmCache);
+  SAMD51DMX.setRDMDeviceStats(&rdmStats);
+  SAMD51DMX.setMinimumDMXRate(30);   // discovery uses the line time left after 30 DMX frames per second
   SAMD51DMX.startRDM(DIRECTION_PIN, RDM_DIRECTION_OUTPUT);
   Serial.println("setup complete");
 }
@@ -0,0 +1,246 @@
+/**************************************************************************/
+/*!
+    @file     LXSimArduino.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Arduino core functions backed by the simulation clock and GPIO model.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include "Arduino.h"
+#include "wiring_private.h"
+#include "LXSimulator.h"
+
+HostSerial Serial;
+
+void pinMode( uint32_t pin, uint32_t mode ) {
+	(void)pin; (void)mode;
+}
+
+void digitalWrite( uint32_t pin, uint32_t val ) {
+	LXSim.setPin(pin, val);
+}
+
+int digitalRead( uint32_t pin ) {
+	return LXSim.pin(pin);
+}
+
+void analogWrite( uint32_t pin, int val ) {
+	(void)pin; (void)val;
+}
+
+int pinPeripheral( uint32_t ulPin, EPioType ulPeripheral ) {
+	(void)ulPin; (void)ulPeripheral;
+	return 0;
+}
+
+void delay( unsigned long ms ) {
+	LXSim.advance(ms * LXSIM_NS_PER_MS);
+}
+
+void delayMicroseconds( unsigned int us ) {
+	LXSim.advance(us * LXSIM_NS_PER_US);
+}
+
+// polling loops must see time pass, so reading the clock outside an ISR costs 1us
+unsigned long micros( void ) {
+	if ( ! LXSim.inISR() ) {
+		LXSim.advance(LXSIM_NS_PER_US);
+	}
+	return (unsigned long)(LXSim.now() / LXSIM_NS_PER_US);
+}
+
+unsigned long millis( void ) {
+	if ( ! LXSim.inISR() ) {
+		LXSim.advance(LXSIM_NS_PER_US);
+	}
+	return (unsigned long)(LXSim.now() / LXSIM_NS_PER_MS);
+}
+
+LXSimDWT LXSimDWTRegisters;
+LXSimCoreDebug LXSimCoreDebugRegisters;
+
+static uint32_t cycle_offset = 0;
+
+static uint32_t host_cycles( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	return (uint32_t)( ns * ( F_CPU / 1000000 ) / 1000 );
+}
+
+LXSimCycleCounter::operator uint32_t() const {
+	return host_cycles() - cycle_offset;
+}
+
+LXSimCycleCounter& LXSimCycleCounter::operator=( uint32_t value ) {
+	cycle_offset = host_cycles() - value;
+	return *this;
+}
+
+void NVIC_SetPriority( IRQn_Type irq, uint32_t priority ) {
+	LXSim.setIRQPriority(irq, priority);
+}
+
+void NVIC_EnableIRQ( IRQn_Type irq ) {
+	LXSim.setIRQEnabled(irq, 1);
+}
+
+void NVIC_DisableIRQ( IRQn_Type irq ) {
+	LXSim.setIRQEnabled(irq, 0);
+}
+
+void NVIC_SetPendingIRQ( IRQn_Type irq ) {
+	LXSim.setIRQPending(irq, 1);
+}
+
+void NVIC_ClearPendingIRQ( IRQn_Type irq ) {
+	LXSim.setIRQPending(irq, 0);
+}
+
+PinDescription g_APinDescription[LXSIM_PORT_GROUPS * 32];
+LXSimPort LXSimPortRegisters;
+
+LXSimPort::LXSimPort( void ) {
+	for (uint8_t g=0; g<LXSIM_PORT_GROUPS; g++) {
+		Group[g].OUT.reg.group = g;
+		Group[g].OUT.reg.id = LXSIM_PORT_OUT;
+		Group[g].OUTSET.reg.group = g;
+		Group[g].OUTSET.reg.id = LXSIM_PORT_OUTSET;
+		Group[g].OUTCLR.reg.group = g;
+		Group[g].OUTCLR.reg.id = LXSIM_PORT_OUTCLR;
+	}
+	for (uint32_t pin=0; pin<LXSIM_PORT_GROUPS*32; pin++) {
+		g_APinDescription[pin].ulPort = pin / 32;
+		g_APinDescription[pin].ulPin = pin % 32;
+	}
+}
+
+LXSimPortReg::operator uint32_t() const {
+	uint32_t value = 0;
+	for (uint8_t bit=0; bit<32; bit++) {
+		if ( LXSim.pin(group * 32 + bit) ) {
+			value |= 1ul << bit;
+		}
+	}
+	return value;
+}
+
+LXSimPortReg& LXSimPortReg::operator=( uint32_t v ) {
+	for (uint8_t bit=0; bit<32; bit++) {
+		uint32_t pin = group * 32 + bit;
+		if ( id == LXSIM_PORT_OUT ) {
+			LXSim.setPin(pin, ( v >> bit ) & 1);
+		} else if ( v & ( 1ul << bit ) ) {
+			LXSim.setPin(pin, ( id == LXSIM_PORT_OUTSET ) ? HIGH : LOW);
+		}
+	}
+	return *this;
+}
+
+uint32_t __get_IPSR( void ) {
+	if ( LXSim.inISR() ) {
+		return LXSIM_SERCOM_IRQ + 16;
+	}
+	if ( LXSim.inSpareISR() ) {
+		return LXSIM_SPARE_IRQ + 16;
+	}
+	return 0;
+}
+
+void noInterrupts( void ) {
+	LXSim.setInterruptsEnabled(0);
+}
+
+void interrupts( void ) {
+	LXSim.setInterruptsEnabled(1);
+}
+
+// ************************  Print  ************************
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t n = 0;
+	while ( size-- ) {
+		n += write(*buffer++);
+	}
+	return n;
+}
+
+size_t Print::print(long n, int base) {
+	char b[24];
+	if ( base == HEX ) {
+		snprintf(b, sizeof(b), "%lX", (unsigned long)n);
+	} else {
+		snprintf(b, sizeof(b), "%ld", n);
+	}
+	return write(b);
+}
+
+size_t Print::print(unsigned long n, int base) {
+	char b[24];
+	snprintf(b, sizeof(b), base == HEX ? "%lX" : "%lu", n);
+	return write(b);
+}
+
+size_t Print::print(double n, int digits) {
+	char b[48];
+	snprintf(b, sizeof(b), "%.*f", digits, n);
+	return write(b);
+}
+
+// ************************  HostSerial  ************************
+
+int HostSerial::available( void ) {
+	return (int)LXSim.serial_in.size();
+}
+
+int HostSerial::read( void ) {
+	if ( LXSim.serial_in.empty() ) {
+		return -1;
+	}
+	uint8_t c = LXSim.serial_in.front();
+	LXSim.serial_in.pop_front();
+	return c;
+}
+
+int HostSerial::peek( void ) {
+	if ( LXSim.serial_in.empty() ) {
+		return -1;
+	}
+	return LXSim.serial_in.front();
+}
+
+size_t HostSerial::readBytes( uint8_t* buffer, size_t length ) {
+	size_t n = 0;
+	while ( ( n < length ) && ! LXSim.serial_in.empty() ) {
+		buffer[n++] = LXSim.serial_in.front();
+		LXSim.serial_in.pop_front();
+	}
+	return n;
+}
+
+int HostSerial::availableForWrite( void ) {
+	return LXSim.serial_write_capacity;
+}
+
+size_t HostSerial::write( uint8_t c ) {
+	LXSim.serial_out.push_back(c);
+	LXSim.serial_write_calls++;
+	return 1;
+}
+
+size_t HostSerial::write( const uint8_t* buffer, size_t size ) {
+	LXSim.serial_out.insert(LXSim.serial_out.end(), buffer, buffer + size);
+	LXSim.serial_write_calls++;
+	return size;
+}
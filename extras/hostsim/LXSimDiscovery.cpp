@@ -0,0 +1,76 @@
+/**************************************************************************/
+/*!
+    @file     LXSimDiscovery.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Binary search RDM discovery using SAMD51DMX as the controller.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <LXSAMD51DMX.h>
+#include <rdm/rdm_utility.h>
+#include "LXSimDiscovery.h"
+
+LXSimDiscovery::LXSimDiscovery( void ) {
+	branches = 0;
+	mutes = 0;
+	false_found = 0;
+}
+
+uint8_t LXSimDiscovery::mute( UID* uid ) {
+	mutes++;
+	return SAMD51DMX.sendRDMDiscoveryMute(uid, RDM_DISC_MUTE);
+}
+
+uint32_t LXSimDiscovery::run( LXSimResponderFarm* farm ) {
+	std::vector<uint64_t> ranges;
+	UID lower, upper, single;
+
+	branches = 0;
+	mutes = 0;
+	false_found = 0;
+	found.clear();
+	ranges.push_back(0);
+	ranges.push_back(0xFFFFFFFFFFFFull);
+
+	SAMD51DMX.sendRDMDiscoveryMute((UID*)&BROADCAST_ALL_DEVICES_ID, RDM_DISC_UNMUTE);
+	while ( ! ranges.empty() ) {
+		uint64_t hi = ranges.back(); ranges.pop_back();
+		uint64_t lo = ranges.back(); ranges.pop_back();
+		lower.setBytes(lo);
+		upper.setBytes(hi);
+		branches++;
+		uint8_t result = SAMD51DMX.sendRDMDiscoveryPacket(&lower, &upper, &single);
+		if ( result == RDM_DID_DISCOVER ) {
+			if ( mute(&single) ) {
+				found.push_back(single.getValue());
+				if ( farm->find(single.getValue()) < 0 ) {
+					false_found++;
+				}
+			}
+			ranges.push_back(lo);				// others may remain in the range
+			ranges.push_back(hi);
+		} else if ( result == RDM_PARTIAL_DISCOVERY ) {
+			if ( lo == hi ) {
+				if ( mute(&lower) ) {
+					found.push_back(lo);
+				}
+			} else {
+				uint64_t mid = lo + ( hi - lo ) / 2;
+				ranges.push_back(mid + 1);
+				ranges.push_back(hi);
+				ranges.push_back(lo);
+				ranges.push_back(mid);
+			}
+		}
+	}
+	return found.size();
+}
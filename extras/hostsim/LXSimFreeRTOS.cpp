@@ -0,0 +1,122 @@
+/**************************************************************************/
+/*!
+    @file     LXSimFreeRTOS.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Single task FreeRTOS API backed by the simulation clock.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "Seeed_Arduino_FreeRTOS.h"
+#include "LXSimulator.h"
+
+LXSimRTOSStats LXSimRTOS;
+
+static struct LXSimTask main_task = { 0, 0 };
+
+BaseType_t xTaskGetSchedulerState( void ) {
+	return taskSCHEDULER_RUNNING;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void ) {
+	return &main_task;
+}
+
+void vTaskDelay( TickType_t ticks ) {
+	LXSimRTOS.delay_ticks += ticks;
+	LXSim.advance( (uint64_t)ticks * ( 1000000000ull / configTICK_RATE_HZ ) );
+}
+
+BaseType_t xTaskNotifyWait( uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t* value, TickType_t ticks ) {
+	TaskHandle_t task = &main_task;
+	if ( ! task->pending ) {
+		task->value &= ~clear_on_entry;
+		LXSimRTOS.notify_waits++;
+		uint64_t start = LXSim.now();
+		uint64_t timeout = ( ticks == portMAX_DELAY ) ? UINT64_MAX - start : (uint64_t)ticks * ( 1000000000ull / configTICK_RATE_HZ );
+		LXSim.runUntil([task]() { return task->pending != 0; }, timeout);
+		LXSimRTOS.blocked_ns += LXSim.now() - start;
+	}
+	if ( value != NULL ) {
+		*value = task->value;
+	}
+	if ( ! task->pending ) {
+		return pdFALSE;
+	}
+	task->pending = 0;
+	task->value &= ~clear_on_exit;
+	LXSimRTOS.notify_wakes++;
+	return pdTRUE;
+}
+
+BaseType_t xTaskNotify( TaskHandle_t task, uint32_t value, eNotifyAction action ) {
+	switch ( action ) {
+		case eSetBits:
+			task->value |= value;
+			break;
+		case eIncrement:
+			task->value++;
+			break;
+		case eSetValueWithoutOverwrite:
+			if ( task->pending ) {
+				return pdFAIL;
+			}
+			task->value = value;
+			break;
+		case eSetValueWithOverwrite:
+			task->value = value;
+			break;
+		default:
+			break;
+	}
+	task->pending = 1;
+	return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR( TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken ) {
+	if ( woken != NULL ) {
+		*woken = pdTRUE;
+	}
+	return xTaskNotify(task, value, action);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t* buffer ) {
+	buffer->holder = NULL;
+	buffer->count = 0;
+	return buffer;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void ) {
+	static StaticSemaphore_t mutexes[4];
+	static uint8_t used = 0;
+	if ( used == 4 ) {
+		return NULL;
+	}
+	return xSemaphoreCreateRecursiveMutexStatic(&mutexes[used++]);
+}
+
+// with one task the mutex is always free or already held by the caller
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t mutex, TickType_t ticks ) {
+	(void)ticks;
+	mutex->holder = xTaskGetCurrentTaskHandle();
+	mutex->count++;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t mutex ) {
+	if ( ( mutex->holder != xTaskGetCurrentTaskHandle() ) || ( mutex->count == 0 ) ) {
+		return pdFALSE;
+	}
+	if ( --mutex->count == 0 ) {
+		mutex->holder = NULL;
+	}
+	return pdTRUE;
+}
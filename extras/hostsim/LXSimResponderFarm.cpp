@@ -0,0 +1,221 @@
+/**************************************************************************/
+/*!
+    @file     LXSimResponderFarm.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Simulated RDM responders answering discovery, mute and GET/SET.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <string.h>
+#include <rdm/rdm_utility.h>
+#include "LXSimResponderFarm.h"
+
+#define LXSIM_DUB_PREAMBLE_LEN 7
+
+LXSimResponderFarm::LXSimResponderFarm( uint32_t seed ) {
+	_seed = seed ? seed : 1;
+	_packet_len = 0;
+	_receiving = 0;
+	_collision_mode = LXSIM_COLLIDE_JITTER;
+	requests = 0;
+	bad_checksums = 0;
+	discovery_requests = 0;
+	discovery_replies = 0;
+}
+
+uint32_t LXSimResponderFarm::random( void ) {		// xorshift32
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	return _seed;
+}
+
+void LXSimResponderFarm::add( uint64_t uid, uint32_t latency_us, float dropout ) {
+	LXSimResponder r;
+	memset(&r, 0, sizeof(LXSimResponder));
+	for (int i=0; i<6; i++) {
+		r.uid[i] = ( uid >> (40-8*i) ) & 0xFF;
+	}
+	r.latency_ns = latency_us * LXSIM_NS_PER_US;
+	r.dropout = ( dropout >= 1.0 ) ? 0xFFFF : (uint16_t)(dropout * 65536);
+	_responders.push_back(r);
+}
+
+void LXSimResponderFarm::addRandom( uint16_t count, uint16_t manufacturer, uint32_t min_latency_us, uint32_t max_latency_us, float dropout ) {
+	for (uint16_t n=0; n<count; n++) {
+		uint64_t uid;
+		do {
+			uid = ( (uint64_t)manufacturer << 32 ) | random();
+		} while ( ( (uid & 0xFFFFFFFF) == 0xFFFFFFFF ) || ( find(uid) >= 0 ) );
+		uint32_t latency = min_latency_us;
+		if ( count > 1 ) {
+			latency += ( (uint64_t)(max_latency_us - min_latency_us) * n ) / (count - 1);
+		}
+		add(uid, latency, dropout);
+	}
+}
+
+int LXSimResponderFarm::find( uint64_t uid ) {
+	uint8_t b[6];
+	for (int i=0; i<6; i++) {
+		b[i] = ( uid >> (40-8*i) ) & 0xFF;
+	}
+	for (size_t i=0; i<_responders.size(); i++) {
+		if ( memcmp(_responders[i].uid, b, 6) == 0 ) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+uint32_t LXSimResponderFarm::mutedCount( void ) {
+	uint32_t n = 0;
+	for (size_t i=0; i<_responders.size(); i++) {
+		n += _responders[i].muted;
+	}
+	return n;
+}
+
+void LXSimResponderFarm::unmuteAll( void ) {
+	for (size_t i=0; i<_responders.size(); i++) {
+		_responders[i].muted = 0;
+	}
+}
+
+// ************************  line  ************************
+
+void LXSimResponderFarm::lineBreak( uint64_t t_ns ) {
+	(void)t_ns;
+	_packet_len = 0;
+	_receiving = 1;
+}
+
+void LXSimResponderFarm::lineByte( uint8_t c, uint64_t t_ns ) {
+	if ( ! _receiving ) {
+		return;
+	}
+	_packet[_packet_len++] = c;
+	if ( _packet[0] != RDM_START_CODE ) {
+		_receiving = 0;								// DMX or another start code
+		return;
+	}
+	if ( ( _packet_len >= 3 ) && ( _packet_len == _packet[2] + 2 ) ) {
+		_receiving = 0;
+		packet(t_ns);
+	} else if ( _packet_len == LXSIM_RDM_MAX_PACKET ) {
+		_receiving = 0;
+	}
+}
+
+uint8_t LXSimResponderFarm::dropped( LXSimResponder* r ) {
+	if ( r->dropout && ( ( random() & 0xFFFF ) < r->dropout ) ) {
+		r->dropped++;
+		return 1;
+	}
+	return 0;
+}
+
+void LXSimResponderFarm::packet( uint64_t t_ns ) {
+	uint8_t len = _packet[2];
+	if ( ( len < RDM_PKT_BASE_MSG_LEN ) || ! testRDMChecksum(rdmChecksum(_packet, len), _packet, len) ) {
+		bad_checksums++;
+		return;
+	}
+	requests++;
+	uint8_t  cmdclass = _packet[20];
+	uint16_t pid = ( _packet[21] << 8 ) | _packet[22];
+	uint8_t* dest = &_packet[3];
+	uint8_t  broadcast = ( ( dest[2] & dest[3] & dest[4] & dest[5] ) == 0xFF );
+
+	if ( ( cmdclass == RDM_DISCOVERY_COMMAND ) && ( pid == RDM_DISC_UNIQUE_BRANCH ) ) {
+		discovery_requests++;
+		for (size_t i=0; i<_responders.size(); i++) {
+			LXSimResponder* r = &_responders[i];
+			if ( ( ! r->muted ) && ( memcmp(r->uid, &_packet[24], 6) >= 0 ) && ( memcmp(r->uid, &_packet[30], 6) <= 0 ) ) {
+				discoveryReply(r, t_ns);
+			}
+		}
+		return;
+	}
+
+	for (size_t i=0; i<_responders.size(); i++) {
+		LXSimResponder* r = &_responders[i];
+		uint8_t addressed = ( memcmp(r->uid, dest, 6) == 0 );
+		if ( broadcast && ( ( dest[0] == 0xFF ) || ( memcmp(r->uid, dest, 2) == 0 ) ) ) {
+			addressed = 2;
+		}
+		if ( ! addressed ) {
+			continue;
+		}
+		if ( cmdclass == RDM_DISCOVERY_COMMAND ) {
+			if ( pid == RDM_DISC_MUTE ) {
+				r->muted = 1;
+			} else if ( pid == RDM_DISC_UNMUTE ) {
+				r->muted = 0;
+			}
+		}
+		if ( addressed == 1 ) {
+			response(r, t_ns);						// only one responder can match
+			return;
+		}
+	}
+}
+
+void LXSimResponderFarm::discoveryReply( LXSimResponder* r, uint64_t t_ns ) {
+	if ( dropped(r) ) {
+		return;
+	}
+	uint8_t reply[LXSIM_DUB_PREAMBLE_LEN + 17];
+	memset(reply, 0xFE, LXSIM_DUB_PREAMBLE_LEN);
+	reply[LXSIM_DUB_PREAMBLE_LEN] = RDM_DISC_PREAMBLE_SEPARATOR;
+	uint8_t* e = &reply[LXSIM_DUB_PREAMBLE_LEN+1];
+	uint16_t checksum = 0;
+	for (int i=0; i<6; i++) {
+		e[2*i] = r->uid[i] | 0xAA;
+		e[2*i+1] = r->uid[i] | 0x55;
+		checksum += e[2*i] + e[2*i+1];
+	}
+	e[12] = ( checksum >> 8 ) | 0xAA;
+	e[13] = ( checksum >> 8 ) | 0x55;
+	e[14] = ( checksum & 0xFF ) | 0xAA;
+	e[15] = ( checksum & 0xFF ) | 0x55;
+
+	uint32_t latency = ( _collision_mode == LXSIM_COLLIDE_ALIGNED ) ? _responders[0].latency_ns : r->latency_ns;
+	LXSim.transmitToUSART(reply, sizeof(reply), 0, t_ns + latency);
+	r->discovery_replies++;
+	discovery_replies++;
+}
+
+void LXSimResponderFarm::response( LXSimResponder* r, uint64_t t_ns ) {
+	if ( dropped(r) ) {
+		return;
+	}
+	uint8_t cmdclass = _packet[20];
+	uint8_t reply[RDM_PKT_BASE_TOTAL_LEN + 2];
+	uint8_t pdl = ( cmdclass == RDM_DISCOVERY_COMMAND ) ? 2 : 0;	// mute replies have a control field
+
+	memcpy(reply, _packet, 24);
+	memcpy(&reply[3], &_packet[9], 6);			// to the controller
+	memcpy(&reply[9], r->uid, 6);
+	reply[2] = RDM_PKT_BASE_MSG_LEN + pdl;
+	reply[16] = RDM_RESPONSE_TYPE_ACK;
+	reply[17] = 0;								// message count
+	reply[20] = cmdclass + 1;
+	reply[23] = pdl;
+	memset(&reply[24], 0, pdl);
+	uint16_t checksum = rdmChecksum(reply, reply[2]);
+	reply[reply[2]] = checksum >> 8;
+	reply[reply[2]+1] = checksum & 0xFF;
+
+	LXSim.transmitToUSART(reply, reply[2]+2, 1, t_ns + r->latency_ns);
+	r->responses++;
+}
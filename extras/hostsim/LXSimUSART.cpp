@@ -0,0 +1,308 @@
+/**************************************************************************/
+/*!
+    @file     LXSimUSART.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Register model of a SAMD51 SERCOM USART.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "SERCOM.h"
+#include "LXSimulator.h"
+
+#define LXSIM_SERCOM_FREQ_REF 48000000ull
+#define LXSIM_BITS_PER_FRAME  11			// 8N2: start + 8 data + 2 stop
+
+Sercom lxsim_sercom2;
+Sercom lxsim_sercom4;
+SERCOM sercom2(&lxsim_sercom2);
+SERCOM sercom4(&lxsim_sercom4);
+
+// ************************  register proxies  ************************
+
+LXSimReg::operator uint32_t() const {
+	return usart->readRegister(id);
+}
+
+LXSimReg& LXSimReg::operator=(uint32_t v) {
+	usart->writeRegister(id, v);
+	return *this;
+}
+
+LXSimBit::operator uint32_t() const {
+	return (usart->readRegister(id) & mask) >> shift;
+}
+
+LXSimBit& LXSimBit::operator=(uint32_t v) {
+	// bit-field writes are read-modify-write of the whole register, as on hardware
+	uint32_t r = usart->readRegister(id);
+	r = (r & ~mask) | ((v << shift) & mask);
+	usart->writeRegister(id, r);
+	return *this;
+}
+
+static void initReg(LXSimReg& r, LXSimUSART* u, uint8_t id) {
+	r.usart = u;
+	r.id = id;
+}
+
+static void initBit(LXSimBit& b, LXSimUSART* u, uint8_t id, uint32_t mask, uint8_t shift) {
+	b.usart = u;
+	b.id = id;
+	b.mask = mask;
+	b.shift = shift;
+}
+
+// ************************  USART model  ************************
+
+LXSimUSART::LXSimUSART( void ) {
+	initReg(CTRLA.reg, this, LXSIM_CTRLA);
+	initBit(CTRLA.bit.SWRST, this, LXSIM_CTRLA, 0x01, 0);
+	initBit(CTRLA.bit.ENABLE, this, LXSIM_CTRLA, 0x02, 1);
+	initBit(CTRLA.bit.TXPO, this, LXSIM_CTRLA, 0x30000, 16);
+	initReg(CTRLC.reg, this, LXSIM_CTRLC);
+	initBit(CTRLC.bit.GTIME, this, LXSIM_CTRLC, 0x07, 0);
+	initReg(BAUD.reg, this, LXSIM_BAUD);
+	initBit(BAUD.FRAC.BAUD, this, LXSIM_BAUD, 0x1FFF, 0);
+	initBit(BAUD.FRAC.FP, this, LXSIM_BAUD, 0xE000, 13);
+	initReg(INTENSET.reg, this, LXSIM_INTENSET);
+	initReg(INTENCLR.reg, this, LXSIM_INTENCLR);
+	initReg(INTFLAG.reg, this, LXSIM_INTFLAG);
+	initBit(INTFLAG.bit.DRE, this, LXSIM_INTFLAG, SERCOM_USART_INTENSET_DRE, 0);
+	initBit(INTFLAG.bit.TXC, this, LXSIM_INTFLAG, SERCOM_USART_INTENSET_TXC, 1);
+	initBit(INTFLAG.bit.RXC, this, LXSIM_INTFLAG, SERCOM_USART_INTENSET_RXC, 2);
+	initBit(INTFLAG.bit.RXS, this, LXSIM_INTFLAG, SERCOM_USART_INTENSET_RXS, 3);
+	initBit(INTFLAG.bit.ERROR, this, LXSIM_INTFLAG, SERCOM_USART_INTENSET_ERROR, 7);
+	initReg(STATUS.reg, this, LXSIM_STATUS);
+	initBit(STATUS.bit.PERR, this, LXSIM_STATUS, SERCOM_USART_STATUS_PERR, 0);
+	initBit(STATUS.bit.FERR, this, LXSIM_STATUS, SERCOM_USART_STATUS_FERR, 1);
+	initBit(STATUS.bit.BUFOVF, this, LXSIM_STATUS, SERCOM_USART_STATUS_BUFOVF, 2);
+	initReg(DATA.reg, this, LXSIM_DATA);
+	tx_generation = 0;
+	reset();
+}
+
+void LXSimUSART::reset( void ) {
+	ctrla_enable = 0;
+	ctrla_txpo = 0;
+	ctrlc_gtime = 0;
+	baud_int = 0;
+	baud_fp = 0;
+	inten = 0;
+	intflag = 0;
+	status = 0;
+	tx_buffer_full = 0;
+	tx_buffer = 0;
+	tx_shifting = 0;
+	tx_shift_byte = 0;
+	rx_count = 0;
+	tx_generation++;
+}
+
+void LXSimUSART::enable( uint8_t e ) {
+	if ( ctrla_enable && ! e ) {			// disabling aborts transmission and flushes receiver
+		tx_generation++;
+		tx_shifting = 0;
+		tx_buffer_full = 0;
+		rx_count = 0;
+	}
+	ctrla_enable = e;
+}
+
+void LXSimUSART::setBaud( uint32_t baud ) {
+	uint64_t baudTimes8 = (LXSIM_SERCOM_FREQ_REF * 8) / (16 * (uint64_t)baud);
+	baud_fp = baudTimes8 % 8;
+	baud_int = baudTimes8 / 8;
+}
+
+uint32_t LXSimUSART::baud( void ) {
+	uint64_t div = 16 * (8 * (uint64_t)baud_int + baud_fp);
+	if ( div == 0 ) {
+		return 0;
+	}
+	return (LXSIM_SERCOM_FREQ_REF * 8) / div;
+}
+
+uint64_t LXSimUSART::bitTimeNs( void ) {
+	uint64_t div = LXSIM_SERCOM_FREQ_REF * 8;
+	return (16 * (8 * (uint64_t)baud_int + baud_fp) * 1000000000ull + div/2) / div;
+}
+
+uint32_t LXSimUSART::readRegister( uint8_t id ) {
+	switch ( id ) {
+		case LXSIM_CTRLA:
+			return (ctrla_enable << 1) | ((uint32_t)ctrla_txpo << 16);
+		case LXSIM_CTRLC:
+			return ctrlc_gtime;
+		case LXSIM_BAUD:
+			return baud_int | ((uint32_t)baud_fp << 13);
+		case LXSIM_INTENSET:
+		case LXSIM_INTENCLR:
+			return inten;
+		case LXSIM_INTFLAG: {
+			uint8_t f = intflag & (SERCOM_USART_INTENSET_TXC | SERCOM_USART_INTENSET_RXS | SERCOM_USART_INTENSET_ERROR);
+			if ( ctrla_enable && ! tx_buffer_full ) {
+				f |= SERCOM_USART_INTENSET_DRE;
+			}
+			if ( rx_count ) {
+				f |= SERCOM_USART_INTENSET_RXC;
+			}
+			return f;
+		}
+		case LXSIM_STATUS:
+			return status;
+		case LXSIM_DATA: {
+			if ( rx_count == 0 ) {
+				return 0;
+			}
+			uint8_t c = rx_fifo[0];
+			rx_fifo[0] = rx_fifo[1];
+			rx_ferr[0] = rx_ferr[1];
+			rx_count--;
+			return c;
+		}
+	}
+	return 0;
+}
+
+void LXSimUSART::writeRegister( uint8_t id, uint32_t v ) {
+	switch ( id ) {
+		case LXSIM_CTRLA:
+			if ( v & 0x01 ) {
+				reset();
+				return;
+			}
+			ctrla_txpo = (v >> 16) & 0x3;
+			enable((v >> 1) & 0x1);
+			break;
+		case LXSIM_CTRLC:
+			ctrlc_gtime = v & 0x7;
+			break;
+		case LXSIM_BAUD:
+			baud_int = v & 0x1FFF;
+			baud_fp = (v >> 13) & 0x7;
+			break;
+		case LXSIM_INTENSET:
+			inten |= v;
+			break;
+		case LXSIM_INTENCLR:
+			inten &= ~v;
+			break;
+		case LXSIM_INTFLAG:		// write one to clear
+			intflag &= ~(v & (SERCOM_USART_INTENSET_TXC | SERCOM_USART_INTENSET_RXS | SERCOM_USART_INTENSET_ERROR));
+			break;
+		case LXSIM_STATUS:		// write one to clear
+			status &= ~v;
+			break;
+		case LXSIM_DATA:
+			if ( ! ctrla_enable ) {
+				return;
+			}
+			intflag &= ~SERCOM_USART_INTENSET_TXC;	// writing data clears TXC
+			tx_buffer = v & 0xFF;
+			tx_buffer_full = 1;
+			if ( ! tx_shifting ) {
+				startShift();
+			}
+			break;
+	}
+}
+
+void LXSimUSART::startShift( void ) {
+	tx_shifting = 1;
+	tx_shift_byte = tx_buffer;
+	tx_buffer_full = 0;
+	uint64_t duration = LXSIM_BITS_PER_FRAME * bitTimeNs();
+	uint32_t gen = tx_generation;
+	LXSim.usartTransmitStart(this, tx_shift_byte, duration);
+	LXSim.schedule(LXSim.now() + duration, [this, gen]() {
+		if ( gen == tx_generation ) {
+			txShiftComplete();
+		}
+	});
+}
+
+void LXSimUSART::txShiftComplete( void ) {
+	if ( tx_buffer_full ) {
+		startShift();
+	} else {
+		tx_shifting = 0;
+		intflag |= SERCOM_USART_INTENSET_TXC;
+	}
+}
+
+void LXSimUSART::rxDeliver( uint8_t c, uint8_t frame_error ) {
+	if ( ! ctrla_enable ) {
+		return;
+	}
+	if ( rx_count < 2 ) {
+		rx_fifo[rx_count] = c;
+		rx_ferr[rx_count] = frame_error;
+		rx_count++;
+	} else {
+		status |= SERCOM_USART_STATUS_BUFOVF;
+		intflag |= SERCOM_USART_INTENSET_ERROR;
+	}
+	if ( frame_error ) {
+		status |= SERCOM_USART_STATUS_FERR;
+		intflag |= SERCOM_USART_INTENSET_ERROR;
+	}
+}
+
+uint8_t LXSimUSART::irqPending( void ) {
+	return ( readRegister(LXSIM_INTFLAG) & inten ) != 0;
+}
+
+// ************************  Arduino SERCOM wrapper subset  ************************
+
+bool SERCOM::isFrameErrorUART( void ) {
+	return sercom->USART.STATUS.bit.FERR;
+}
+
+void SERCOM::clearFrameErrorUART( void ) {
+	sercom->USART.STATUS.bit.FERR = 1;
+}
+
+uint8_t SERCOM::readDataUART( void ) {
+	return sercom->USART.DATA.reg;
+}
+
+bool SERCOM::isUARTError( void ) {
+	return sercom->USART.INTFLAG.bit.ERROR;
+}
+
+void SERCOM::acknowledgeUARTError( void ) {
+	sercom->USART.INTFLAG.bit.ERROR = 1;
+}
+
+void SERCOM::clearStatusUART( void ) {
+	sercom->USART.STATUS.reg = 0;		// same as the Arduino core: writing zero clears nothing
+}
+
+Uart::Uart( SERCOM* s, uint8_t pinRX, uint8_t pinTX, SercomRXPad padRX, SercomUartTXPad padTX ) {
+	(void)pinRX; (void)pinTX; (void)padRX; (void)padTX;
+	_sercom = s;
+}
+
+void Uart::begin( unsigned long baud, uint16_t config ) {
+	(void)config;
+	LXSimUSART* u = &_sercom->sercom->USART;
+	u->reset();
+	u->setBaud(baud);
+	u->inten = SERCOM_USART_INTENSET_RXC | SERCOM_USART_INTENSET_ERROR;
+	u->enable(1);
+	LXSim.setUSART(u);
+	LXSim.setIRQPriority(LXSIM_SERCOM_IRQ, LXSIM_LOWEST_PRIORITY);	// as SERCOM::initUART does
+}
+
+void Uart::end( void ) {
+	_sercom->sercom->USART.reset();
+}
@@ -0,0 +1,305 @@
+/**************************************************************************/
+/*!
+    @file     LXSimulator.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Virtual clock, interrupt dispatch, GPIO and DMX line model.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "LXSimulator.h"
+
+#define LXSIM_SLOT_NS        44000ull		// one 8N2 character at 250kbaud
+#define LXSIM_REPLY_BREAK_NS 176000ull
+#define LXSIM_REPLY_MAB_NS   12000ull
+#define LXSIM_ISR_STORM      100000
+
+extern void LX_SERCOM_Handler( void );
+extern void FREQM_Handler( void ) __attribute__((weak));		// defined by the driver when input is built
+
+LXSimulator LXSim;
+
+LXSimulator::LXSimulator( void ) {
+	_isr = LX_SERCOM_Handler;
+	_spare_isr = FREQM_Handler;
+	_spare_irq = LXSIM_SPARE_IRQ;
+	_usart = &lxsim_sercom2.USART;
+	reset();
+}
+
+void LXSimulator::reset( void ) {
+	_now = 0;
+	_seq = 0;
+	_events.clear();
+	_rx_slots.clear();
+	_devices.clear();
+	_in_isr = 0;
+	_in_spare_isr = 0;
+	_interrupts_enabled = 1;
+	memset(_irq_priority, 0, sizeof(_irq_priority));
+	memset(_irq_enabled, 0, sizeof(_irq_enabled));
+	memset(_irq_pending, 0, sizeof(_irq_pending));
+	_irq_priority[LXSIM_SERCOM_IRQ] = LXSIM_LOWEST_PRIORITY;
+	memset(_pins, 0, sizeof(_pins));
+	_direction_pin = LXSIM_NO_PIN;
+	serial_in.clear();
+	serial_out.clear();
+	serial_write_calls = 0;
+	serial_write_capacity = 64;
+	isr_calls = 0;
+	spare_isr_calls = 0;
+	tx_bytes = 0;
+	tx_breaks = 0;
+	rx_bytes = 0;
+	rx_collisions = 0;
+	direction_changes = 0;
+	last_direction_high_ns = 0;
+	last_direction_low_ns = 0;
+	last_line_byte_end_ns = 0;
+}
+
+// ************************  clock  ************************
+
+void LXSimulator::schedule( uint64_t at_ns, std::function<void()> fn ) {
+	if ( at_ns < _now ) {
+		at_ns = _now;
+	}
+	Event e;
+	e.seq = _seq++;
+	e.fn = fn;
+	_events.insert(std::make_pair(at_ns, e));		// multimap keeps insertion order for equal keys
+}
+
+void LXSimulator::runEvents( uint64_t until ) {
+	while ( ! _events.empty() ) {
+		std::multimap<uint64_t, Event>::iterator it = _events.begin();
+		if ( it->first > until ) {
+			break;
+		}
+		_now = it->first;
+		std::function<void()> fn = it->second.fn;
+		_events.erase(it);
+		fn();
+		serviceInterrupts();
+	}
+}
+
+void LXSimulator::advance( uint64_t ns ) {
+	runUntil(_now + ns);
+}
+
+void LXSimulator::runUntil( uint64_t t_ns ) {
+	serviceInterrupts();
+	runEvents(t_ns);
+	if ( t_ns > _now ) {
+		_now = t_ns;
+	}
+	serviceInterrupts();
+}
+
+uint8_t LXSimulator::runUntil( std::function<bool()> test, uint64_t timeout_ns ) {
+	uint64_t end = _now + timeout_ns;
+	while ( _now < end ) {
+		if ( test() ) {
+			return 1;
+		}
+		advance(LXSIM_NS_PER_US);
+	}
+	return test() ? 1 : 0;
+}
+
+// ************************  interrupts  ************************
+
+void LXSimulator::setInterruptsEnabled( uint8_t e ) {
+	_interrupts_enabled = e;
+	if ( e ) {
+		serviceInterrupts();
+	}
+}
+
+void LXSimulator::setIRQPriority( int irq, uint32_t priority ) {
+	if ( ( irq >= 0 ) && ( irq < LXSIM_IRQS ) ) {
+		_irq_priority[irq] = priority;
+	}
+}
+
+void LXSimulator::setIRQEnabled( int irq, uint8_t e ) {
+	if ( ( irq >= 0 ) && ( irq < LXSIM_IRQS ) ) {
+		_irq_enabled[irq] = e;
+		serviceInterrupts();
+	}
+}
+
+void LXSimulator::setIRQPending( int irq, uint8_t p ) {
+	if ( ( irq >= 0 ) && ( irq < LXSIM_IRQS ) ) {
+		_irq_pending[irq] = p;
+		serviceInterrupts();
+	}
+}
+
+void LXSimulator::serviceInterrupts( void ) {
+	if ( ! _interrupts_enabled ) {
+		return;
+	}
+	serviceSERCOM();
+	// a pending spare interrupt runs when no handler is active or it preempted returns
+	while ( ( _spare_isr != NULL ) && _irq_enabled[_spare_irq] && _irq_pending[_spare_irq]
+			&& ( ! _in_isr ) && ( ! _in_spare_isr ) && _interrupts_enabled ) {
+		_irq_pending[_spare_irq] = 0;
+		_in_spare_isr = 1;
+		spare_isr_calls++;
+		_spare_isr();
+		_in_spare_isr = 0;
+		serviceSERCOM();
+	}
+}
+
+void LXSimulator::serviceSERCOM( void ) {
+	if ( _in_isr || ( ! _interrupts_enabled ) || ( _isr == NULL ) || ( _usart == NULL ) ) {
+		return;
+	}
+	if ( _in_spare_isr && ( _irq_priority[LXSIM_SERCOM_IRQ] >= _irq_priority[_spare_irq] ) ) {
+		return;											// can't preempt the spare handler
+	}
+	int guard = 0;
+	while ( _usart->irqPending() ) {
+		if ( ++guard > LXSIM_ISR_STORM ) {
+			fprintf(stderr, "LXSim: interrupt storm at %llu ns (INTFLAG 0x%02x INTEN 0x%02x)\n",
+					(unsigned long long)_now, (unsigned)_usart->readRegister(LXSIM_INTFLAG), _usart->inten);
+			_usart->inten = 0;
+			break;
+		}
+		_in_isr = 1;
+		isr_calls++;
+		_isr();
+		_in_isr = 0;
+	}
+}
+
+// ************************  gpio  ************************
+
+void LXSimulator::setPin( uint32_t pin, uint8_t level ) {
+	pin &= 0xFF;
+	level = level ? 1 : 0;
+	if ( ( pin == _direction_pin ) && ( _pins[pin] != level ) ) {
+		direction_changes++;
+		if ( level ) {
+			last_direction_high_ns = _now;
+		} else {
+			last_direction_low_ns = _now;
+		}
+	}
+	_pins[pin] = level;
+}
+
+uint8_t LXSimulator::lineDriverEnabled( void ) {
+	if ( _direction_pin == LXSIM_NO_PIN ) {
+		return 1;
+	}
+	return _pins[_direction_pin];
+}
+
+// ************************  line  ************************
+
+void LXSimulator::attach( LXSimBusDevice* d ) {
+	_devices.push_back(d);
+}
+
+void LXSimulator::detach( LXSimBusDevice* d ) {
+	for (size_t i=0; i<_devices.size(); i++) {
+		if ( _devices[i] == d ) {
+			_devices.erase(_devices.begin() + i);
+			return;
+		}
+	}
+}
+
+void LXSimulator::usartTransmitStart( LXSimUSART* u, uint8_t c, uint64_t duration_ns ) {
+	tx_bytes++;
+	if ( ! lineDriverEnabled() ) {
+		return;								// shifted out with the line driver off
+	}
+	if ( ( c == 0 ) && ( u->baud() < 200000 ) ) {
+		tx_breaks++;
+		std::vector<LXSimBusDevice*> devices = _devices;
+		for (size_t i=0; i<devices.size(); i++) {
+			devices[i]->lineBreak(_now);
+		}
+		return;
+	}
+	uint64_t end = _now + duration_ns;
+	schedule(end, [this, c, end]() {
+		last_line_byte_end_ns = end;
+		std::vector<LXSimBusDevice*> devices = _devices;
+		for (size_t i=0; i<devices.size(); i++) {
+			devices[i]->lineByte(c, end);
+		}
+	});
+}
+
+uint64_t LXSimulator::replyEndTime( uint16_t len, uint8_t with_break, uint64_t start_ns ) {
+	uint64_t t = start_ns;
+	if ( with_break ) {
+		t += LXSIM_REPLY_BREAK_NS + LXSIM_REPLY_MAB_NS;
+	}
+	return t + len * LXSIM_SLOT_NS;
+}
+
+void LXSimulator::transmitToUSART( const uint8_t* bytes, uint16_t len, uint8_t with_break, uint64_t start_ns ) {
+	std::vector<std::pair<uint64_t, std::pair<uint8_t, uint8_t> > > arrivals;
+	uint64_t t = start_ns;
+	if ( with_break ) {
+		arrivals.push_back(std::make_pair(t + LXSIM_SLOT_NS, std::make_pair((uint8_t)0, (uint8_t)1)));
+		t += LXSIM_REPLY_BREAK_NS + LXSIM_REPLY_MAB_NS;
+	}
+	for (uint16_t i=0; i<len; i++) {
+		arrivals.push_back(std::make_pair(t + (i+1) * LXSIM_SLOT_NS, std::make_pair(bytes[i], (uint8_t)0)));
+	}
+
+	for (size_t i=0; i<arrivals.size(); i++) {
+		uint64_t at = arrivals[i].first;
+		// a character already arriving within half a slot collides with this one
+		std::map<uint64_t, RxSlot>::iterator it = _rx_slots.lower_bound(at > LXSIM_SLOT_NS/2 ? at - LXSIM_SLOT_NS/2 : 0);
+		if ( ( it != _rx_slots.end() ) && ( it->first <= at + LXSIM_SLOT_NS/2 ) ) {
+			it->second.c |= arrivals[i].second.first;
+			it->second.ferr |= arrivals[i].second.second;
+			it->second.count++;
+			continue;
+		}
+		RxSlot s;
+		s.c = arrivals[i].second.first;
+		s.ferr = arrivals[i].second.second;
+		s.count = 1;
+		_rx_slots[at] = s;
+		schedule(at, [this, at]() { deliverRx(at); });
+	}
+}
+
+void LXSimulator::deliverRx( uint64_t key ) {
+	std::map<uint64_t, RxSlot>::iterator it = _rx_slots.find(key);
+	if ( it == _rx_slots.end() ) {
+		return;
+	}
+	RxSlot s = it->second;
+	_rx_slots.erase(it);
+	if ( s.count > 1 ) {
+		rx_collisions++;
+	}
+	if ( ( _direction_pin != LXSIM_NO_PIN ) && _pins[_direction_pin] ) {
+		return;								// receiver disabled while driving the line
+	}
+	rx_bytes++;
+	if ( _usart ) {
+		_usart->rxDeliver(s.c, s.ferr);
+	}
+}
@@ -0,0 +1,142 @@
+/**************************************************************************/
+/*!
+    @file     Arduino.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Minimal Arduino core surface used by LXSAMD51DMX so that the driver
+    compiles and runs against the simulated SERCOM on a Linux host.
+    Time is virtual: delay() and micros() advance the simulation clock.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_ARDUINO_H
+#define LXHOSTSIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "WString.h"
+#include "Print.h"
+#include "Printable.h"
+#include "sam.h"
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void pinMode( uint32_t pin, uint32_t mode );
+void digitalWrite( uint32_t pin, uint32_t val );
+int  digitalRead( uint32_t pin );
+void analogWrite( uint32_t pin, int val );
+
+void delay( unsigned long ms );
+void delayMicroseconds( unsigned int us );
+unsigned long micros( void );
+unsigned long millis( void );
+
+void noInterrupts( void );
+void interrupts( void );
+
+#ifndef F_CPU
+#define F_CPU 120000000L
+#endif
+
+/*!
+@class LXSimCycleCounter
+@abstract
+   Stands in for DWT->CYCCNT.  It counts host time scaled to F_CPU cycles,
+   not virtual time, so profiled handlers report what they cost on the host.
+*/
+class LXSimCycleCounter {
+  public:
+	operator uint32_t() const;
+	LXSimCycleCounter& operator=( uint32_t value );
+};
+
+typedef struct {
+	uint32_t          CTRL;
+	LXSimCycleCounter CYCCNT;
+} LXSimDWT;
+
+typedef struct {
+	uint32_t DEMCR;
+} LXSimCoreDebug;
+
+extern LXSimDWT LXSimDWTRegisters;
+extern LXSimCoreDebug LXSimCoreDebugRegisters;
+
+#define DWT       (&LXSimDWTRegisters)
+#define CoreDebug (&LXSimCoreDebugRegisters)
+#define DWT_CTRL_CYCCNTENA_Msk      (1ul << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1ul << 24)
+
+// NVIC, only the interrupts the driver uses, numbered as on the SAMD51
+#define __NVIC_PRIO_BITS 3
+
+typedef enum {
+	FREQM_IRQn     = 28,
+	SERCOM2_0_IRQn = 54,
+	SERCOM4_0_IRQn = 62,
+	LXSIM_IRQ_COUNT = 138
+} IRQn_Type;
+
+void NVIC_SetPriority( IRQn_Type irq, uint32_t priority );
+void NVIC_EnableIRQ( IRQn_Type irq );
+void NVIC_DisableIRQ( IRQn_Type irq );
+void NVIC_SetPendingIRQ( IRQn_Type irq );
+void NVIC_ClearPendingIRQ( IRQn_Type irq );
+
+// exception number of the running handler, 0 in thread mode
+uint32_t __get_IPSR( void );
+
+// pin n is bit n % 32 of PORT group n / 32
+typedef struct {
+	uint8_t  ulPort;
+	uint32_t ulPin;
+} PinDescription;
+
+extern PinDescription g_APinDescription[LXSIM_PORT_GROUPS * 32];
+
+/*!
+@class HostSerial
+@abstract
+   Stands in for the USB Serial object.  Bytes written by the sketch are
+   collected for inspection, bytes read come from a queue filled by the host.
+*/
+class HostSerial : public Print {
+  public:
+	void begin( unsigned long baud ) { (void)baud; }
+	void end( void ) {}
+	operator bool() { return true; }
+
+	int  available( void );
+	int  read( void );
+	int  peek( void );
+	size_t readBytes( uint8_t* buffer, size_t length );
+	size_t readBytes( char* buffer, size_t length ) { return readBytes((uint8_t*)buffer, length); }
+	int  availableForWrite( void );
+	void flush( void ) {}
+
+	size_t write( uint8_t c );
+	size_t write( const uint8_t* buffer, size_t size );
+	using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,56 @@
+/**************************************************************************/
+/*!
+    @file     LXSimDiscovery.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Binary search RDM discovery using SAMD51DMX as the controller.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXSIMDISCOVERY_H
+#define LXSIMDISCOVERY_H
+
+#include <stdint.h>
+#include <vector>
+#include "LXSimResponderFarm.h"
+
+class UID;
+
+/*!
+@class LXSimDiscovery
+@abstract
+   LXSimDiscovery finds the responders of a farm with sendRDMDiscoveryPacket and sendRDMDiscoveryMute.
+   All responders are unmuted first.  A range that gets a valid reply is searched again after the
+   responder is muted, a range with a collision is split in two.
+   
+   SAMD51DMX must have been started with startRDM(pin, RDM_DIRECTION_OUTPUT).
+*/
+
+class LXSimDiscovery {
+  public:
+	LXSimDiscovery( void );
+
+	/*!
+	 * @brief clears the counts and discovers the responders of farm
+	 * @return number of UIDs found
+	 */
+	uint32_t run( LXSimResponderFarm* farm );
+
+	uint32_t branches;				// DISC_UNIQUE_BRANCH sent
+	uint32_t mutes;					// DISC_MUTE sent, including retries
+	uint32_t false_found;			// muted a UID that is not in the farm
+	std::vector<uint64_t> found;
+
+  private:
+	uint8_t  mute( UID* uid );
+};
+
+#endif
@@ -0,0 +1,112 @@
+/**************************************************************************/
+/*!
+    @file     LXSimResponderFarm.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Any number of simulated RDM responders sharing the line.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXSIMRESPONDERFARM_H
+#define LXSIMRESPONDERFARM_H
+
+#include <stdint.h>
+#include <vector>
+#include "LXSimulator.h"
+
+// DISC_UNIQUE_BRANCH replies
+#define LXSIM_COLLIDE_JITTER  0		// each responder replies after its own latency, replies overlap partly
+#define LXSIM_COLLIDE_ALIGNED 1		// all replies start together, every byte is OR'd with the others
+
+#define LXSIM_RDM_MAX_PACKET  257
+
+/*!
+ * @brief one simulated responder
+ */
+typedef struct {
+	uint8_t  uid[6];
+	uint32_t latency_ns;			// end of request to start of reply
+	uint16_t dropout;				// chance of not replying, in 1/65536ths
+	uint8_t  muted;
+	uint32_t discovery_replies;
+	uint32_t responses;
+	uint32_t dropped;
+} LXSimResponder;
+
+/*!
+@class LXSimResponderFarm
+@abstract
+   LXSimResponderFarm attaches to LXSim as a single bus device and answers for all of its responders.
+   
+   DISC_UNIQUE_BRANCH is answered by every unmuted responder in range with an encoded UID.
+   Replies are passed to LXSim.transmitToUSART() so those landing in the same slot are OR'd together.
+   DISC_MUTE and DISC_UNMUTE addressed to a responder are acknowledged, broadcasts are not.
+   GET and SET commands addressed to a responder are acknowledged with no parameter data.
+   
+   Latencies and dropouts use a fixed seed so a run can be repeated.
+*/
+
+class LXSimResponderFarm : public LXSimBusDevice {
+  public:
+	LXSimResponderFarm( uint32_t seed = 1 );
+
+	/*!
+	 * @brief adds a responder
+	 * @param latency_us time from the end of a request to the reply (RDM allows 176 to 2000us)
+	 * @param dropout fraction of requests not answered, 0.0 to 1.0
+	 */
+	void     add( uint64_t uid, uint32_t latency_us = 200, float dropout = 0.0 );
+
+	/*!
+	 * @brief adds count responders with random device ids for manufacturer
+	 * @discussion latencies are spread evenly from min_latency_us to max_latency_us
+	 */
+	void     addRandom( uint16_t count, uint16_t manufacturer, uint32_t min_latency_us, uint32_t max_latency_us, float dropout = 0.0 );
+
+	/*!
+	 * @brief LXSIM_COLLIDE_JITTER or LXSIM_COLLIDE_ALIGNED (all use the first responder's latency)
+	 */
+	void     setCollisionMode( uint8_t mode ) { _collision_mode = mode; }
+
+	size_t   count( void ) { return _responders.size(); }
+	LXSimResponder* responder( size_t index ) { return &_responders[index]; }
+	/*!
+	 * @brief index of the responder with uid, -1 if none
+	 */
+	int      find( uint64_t uid );
+	uint32_t mutedCount( void );
+	void     unmuteAll( void );
+
+	void     lineBreak( uint64_t t_ns ) override;
+	void     lineByte( uint8_t c, uint64_t t_ns ) override;
+
+	// ----- statistics -----
+	uint32_t requests;				// complete packets with a good checksum
+	uint32_t bad_checksums;
+	uint32_t discovery_requests;
+	uint32_t discovery_replies;		// replies sent, several may collide for one request
+
+  private:
+	void     packet( uint64_t t_ns );
+	void     discoveryReply( LXSimResponder* r, uint64_t t_ns );
+	void     response( LXSimResponder* r, uint64_t t_ns );
+	uint8_t  dropped( LXSimResponder* r );
+	uint32_t random( void );
+
+	std::vector<LXSimResponder> _responders;
+	uint8_t  _packet[LXSIM_RDM_MAX_PACKET];
+	uint16_t _packet_len;
+	uint8_t  _receiving;
+	uint8_t  _collision_mode;
+	uint32_t _seed;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/**************************************************************************/
+/*!
+    @file     LXSimulator.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Virtual clock, event queue, GPIO and DMX line model shared by the
+    simulated SERCOM and the Arduino shims.
+
+    The driver's interrupt handler is called whenever an enabled SERCOM
+    interrupt flag is set and the clock advances.  Interrupt handlers run in
+    zero virtual time so measurements do not depend on host speed.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXSIMULATOR_H
+#define LXSIMULATOR_H
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <vector>
+#include <deque>
+#include "SERCOM.h"
+
+#define LXSIM_NS_PER_US 1000ull
+#define LXSIM_NS_PER_MS 1000000ull
+
+#define LXSIM_NO_PIN 255
+
+// NVIC interrupt numbers and the priority the Arduino core gives a SERCOM
+#define LXSIM_IRQS            138
+#define LXSIM_SERCOM_IRQ      54		// SERCOM2_0_IRQn
+#define LXSIM_SPARE_IRQ       28		// FREQM_IRQn
+#define LXSIM_LOWEST_PRIORITY 7
+
+/*!
+@class LXSimBusDevice
+@abstract
+   Something attached to the DMX line (a DMX receiver, an RDM responder...)
+   Sees what the driver transmits while its direction pin enables the line driver.
+*/
+class LXSimBusDevice {
+  public:
+	virtual ~LXSimBusDevice() {}
+	/*!
+	 * @brief called at the start of a break on the line
+	 */
+	virtual void lineBreak( uint64_t t_ns ) { (void)t_ns; }
+	/*!
+	 * @brief called when a byte has been completely received from the line
+	 */
+	virtual void lineByte( uint8_t c, uint64_t t_ns ) { (void)c; (void)t_ns; }
+};
+
+/*!
+@class LXSimulator
+@abstract
+   Single instance LXSim drives the simulation.
+*/
+class LXSimulator {
+  public:
+	LXSimulator( void );
+
+	void     reset( void );
+
+	// ----- clock -----
+	uint64_t now( void ) { return _now; }
+	void     schedule( uint64_t at_ns, std::function<void()> fn );
+	void     advance( uint64_t ns );
+	void     runUntil( uint64_t t_ns );
+	/*!
+	 * @brief run until test() returns true or timeout_ns elapses
+	 * @return 1 if test() became true
+	 */
+	uint8_t  runUntil( std::function<bool()> test, uint64_t timeout_ns );
+
+	// ----- interrupts -----
+	void     setISR( void (*isr)(void) ) { _isr = isr; }
+	void     setInterruptsEnabled( uint8_t e );
+	uint8_t  inISR( void ) { return _in_isr; }
+	void     serviceInterrupts( void );
+	/*!
+	 * @brief NVIC state, used for the SERCOM interrupt and a spare one the driver pends for deferred work
+	 * @discussion The spare handler runs once no SERCOM handler is active.  While it runs, the SERCOM
+	 *             interrupt is taken only if its priority is higher (a lower number).
+	 */
+	void     setIRQPriority( int irq, uint32_t priority );
+	void     setIRQEnabled( int irq, uint8_t e );
+	void     setIRQPending( int irq, uint8_t p );
+	void     setSpareISR( int irq, void (*isr)(void) ) { _spare_irq = irq; _spare_isr = isr; }
+	uint8_t  inSpareISR( void ) { return _in_spare_isr; }
+
+	// ----- gpio -----
+	void     setPin( uint32_t pin, uint8_t level );
+	uint8_t  pin( uint32_t pin ) { return _pins[pin & 0xFF]; }
+	/*!
+	 * @brief pin connected to the transceiver's DE/!RE inputs (LXSIM_NO_PIN = always driving)
+	 */
+	void     setDirectionPin( uint8_t pin ) { _direction_pin = pin; }
+	uint8_t  lineDriverEnabled( void );
+
+	// ----- line -----
+	void     attach( LXSimBusDevice* d );
+	void     detach( LXSimBusDevice* d );
+	/*!
+	 * @brief called by the USART model when a byte starts shifting out
+	 */
+	void     usartTransmitStart( LXSimUSART* u, uint8_t c, uint64_t duration_ns );
+	/*!
+	 * @brief a device on the line transmits to the driver's receiver
+	 * @discussion bytes are placed in 44us slots starting at start_ns (after an optional break).
+	 *             Bytes from different devices that land in the same slot are OR'd together.
+	 */
+	void     transmitToUSART( const uint8_t* bytes, uint16_t len, uint8_t with_break, uint64_t start_ns );
+	/*!
+	 * @brief time in ns at which a reply started at start_ns would finish
+	 */
+	uint64_t replyEndTime( uint16_t len, uint8_t with_break, uint64_t start_ns );
+
+	LXSimUSART* usart( void ) { return _usart; }
+	void     setUSART( LXSimUSART* u ) { _usart = u; }
+
+	// ----- usb serial -----
+	std::deque<uint8_t>  serial_in;
+	std::vector<uint8_t> serial_out;
+	uint32_t serial_write_calls;
+	int      serial_write_capacity;
+
+	// ----- statistics -----
+	uint64_t isr_calls;
+	uint64_t spare_isr_calls;
+	uint64_t tx_bytes;
+	uint64_t tx_breaks;
+	uint64_t rx_bytes;
+	uint64_t rx_collisions;
+	uint64_t direction_changes;
+	uint64_t last_direction_high_ns;
+	uint64_t last_direction_low_ns;
+	uint64_t last_line_byte_end_ns;
+
+  private:
+	struct Event {
+		uint64_t seq;
+		std::function<void()> fn;
+	};
+	struct RxSlot {
+		uint8_t c;
+		uint8_t ferr;
+		uint8_t count;
+	};
+
+	void     runEvents( uint64_t until );
+	void     deliverRx( uint64_t key );
+	void     serviceSERCOM( void );
+
+	uint64_t _now;
+	uint64_t _seq;
+	std::multimap<uint64_t, Event> _events;
+	std::map<uint64_t, RxSlot> _rx_slots;
+	std::vector<LXSimBusDevice*> _devices;
+	void   (*_isr)(void);
+	uint8_t  _in_isr;
+	void   (*_spare_isr)(void);
+	int      _spare_irq;
+	uint8_t  _in_spare_isr;
+	uint8_t  _irq_priority[LXSIM_IRQS];
+	uint8_t  _irq_enabled[LXSIM_IRQS];
+	uint8_t  _irq_pending[LXSIM_IRQS];
+	uint8_t  _interrupts_enabled;
+	uint8_t  _pins[256];
+	uint8_t  _direction_pin;
+	LXSimUSART* _usart;
+};
+
+extern LXSimulator LXSim;
+
+#endif
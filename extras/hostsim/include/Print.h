@@ -0,0 +1,52 @@
+/**************************************************************************/
+/*!
+    @file     Print.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Arduino core stand-in
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_PRINT_H
+#define LXHOSTSIM_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "WString.h"
+#include "Printable.h"
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+  public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+	size_t print(const char* s) { return write(s); }
+	size_t print(const String& s) { return write(s.c_str()); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(int n, int base = DEC) { return print((long)n, base); }
+	size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t print(const Printable& p) { return p.printTo(*this); }
+
+	size_t println( void ) { return write("\r\n"); }
+	template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+	template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+};
+
+#endif
@@ -0,0 +1,31 @@
+/**************************************************************************/
+/*!
+    @file     Printable.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Arduino core stand-in
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_PRINTABLE_H
+#define LXHOSTSIM_PRINTABLE_H
+
+#include <stddef.h>
+
+class Print;
+
+class Printable {
+  public:
+	virtual ~Printable() {}
+	virtual size_t printTo(Print& p) const = 0;
+};
+
+#endif
@@ -0,0 +1,188 @@
+/**************************************************************************/
+/*!
+    @file     SERCOM.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Register model of a SAMD51 SERCOM in USART mode.
+
+    The driver writes DMX_SERCOM->USART.<REG>.reg and .bit fields exactly as it
+    does on hardware.  Each register is a small proxy object that forwards reads
+    and writes to LXSimUSART, which models the transmit shift register,
+    the data register, the receive buffer and the interrupt flags against a
+    virtual clock.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_SERCOM_H
+#define LXHOSTSIM_SERCOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sam.h"
+
+// INTFLAG/INTENSET/INTENCLR bits
+#define SERCOM_USART_INTENSET_DRE    0x01
+#define SERCOM_USART_INTENSET_TXC    0x02
+#define SERCOM_USART_INTENSET_RXC    0x04
+#define SERCOM_USART_INTENSET_RXS    0x08
+#define SERCOM_USART_INTENSET_ERROR  0x80
+#define SERCOM_USART_INTENCLR_DRE    0x01
+#define SERCOM_USART_INTENCLR_TXC    0x02
+#define SERCOM_USART_INTENCLR_RXC    0x04
+#define SERCOM_USART_INTENCLR_RXS    0x08
+#define SERCOM_USART_INTENCLR_ERROR  0x80
+
+// STATUS bits
+#define SERCOM_USART_STATUS_PERR     0x01
+#define SERCOM_USART_STATUS_FERR     0x02
+#define SERCOM_USART_STATUS_BUFOVF   0x04
+
+typedef enum {
+	SERCOM_RX_PAD_0 = 0,
+	SERCOM_RX_PAD_1,
+	SERCOM_RX_PAD_2,
+	SERCOM_RX_PAD_3
+} SercomRXPad;
+
+typedef enum {
+	UART_TX_PAD_0 = 0x0ul,
+	UART_TX_PAD_2 = 0x1ul,
+	UART_TX_RTS_CTS_PAD_0_2_3 = 0x2ul,
+	UART_TX_RS485_PAD_0_2 = 0x3ul
+} SercomUartTXPad;
+
+#define SERIAL_8N1 0x11
+#define SERIAL_8N2 0x31
+
+enum LXSimRegId {
+	LXSIM_CTRLA,
+	LXSIM_CTRLC,
+	LXSIM_BAUD,
+	LXSIM_INTENSET,
+	LXSIM_INTENCLR,
+	LXSIM_INTFLAG,
+	LXSIM_STATUS,
+	LXSIM_DATA
+};
+
+class LXSimUSART;
+
+struct LXSimReg {
+	LXSimUSART* usart;
+	uint8_t id;
+	operator uint32_t() const;
+	LXSimReg& operator=(uint32_t v);
+};
+
+struct LXSimBit {
+	LXSimUSART* usart;
+	uint8_t id;
+	uint32_t mask;
+	uint8_t shift;
+	operator uint32_t() const;
+	LXSimBit& operator=(uint32_t v);
+};
+
+/*!
+@class LXSimUSART
+@abstract
+   Simulated USART.  Exposes the same register names as SercomUsart so that
+   DMX_SERCOM->USART.* expressions compile unchanged.
+*/
+class LXSimUSART {
+  public:
+	LXSimUSART( void );
+
+	struct { LXSimReg reg; struct { LXSimBit SWRST, ENABLE, TXPO; } bit; } CTRLA;
+	struct { LXSimReg reg; struct { LXSimBit GTIME; } bit; } CTRLC;
+	struct { LXSimReg reg; struct { LXSimBit BAUD, FP; } FRAC; } BAUD;
+	struct { LXSimReg reg; } INTENSET;
+	struct { LXSimReg reg; } INTENCLR;
+	struct { LXSimReg reg; struct { LXSimBit DRE, TXC, RXC, RXS, ERROR; } bit; } INTFLAG;
+	struct { LXSimReg reg; struct { LXSimBit PERR, FERR, BUFOVF; } bit; } STATUS;
+	struct { LXSimReg reg; } DATA;
+
+	uint32_t readRegister( uint8_t id );
+	void     writeRegister( uint8_t id, uint32_t v );
+
+	// ----- model hooks used by the simulation -----
+	void     reset( void );
+	void     enable( uint8_t e );
+	void     setBaud( uint32_t baud );
+	uint32_t baud( void );
+	uint64_t bitTimeNs( void );
+	uint8_t  irqPending( void );
+	void     txShiftComplete( void );
+	void     rxDeliver( uint8_t c, uint8_t frame_error );
+
+	uint8_t  ctrla_enable;
+	uint8_t  ctrla_txpo;
+	uint8_t  ctrlc_gtime;
+	uint16_t baud_int;
+	uint8_t  baud_fp;
+	uint8_t  inten;
+	uint8_t  intflag;
+	uint8_t  status;
+
+	uint8_t  tx_buffer_full;
+	uint8_t  tx_buffer;
+	uint8_t  tx_shifting;
+	uint8_t  tx_shift_byte;
+
+	uint8_t  rx_count;
+	uint8_t  rx_fifo[2];
+	uint8_t  rx_ferr[2];
+
+	uint32_t tx_generation;
+
+  private:
+	void startShift( void );
+};
+
+struct Sercom {
+	LXSimUSART USART;
+};
+
+extern Sercom lxsim_sercom2;
+extern Sercom lxsim_sercom4;
+#define SERCOM2 (&lxsim_sercom2)
+#define SERCOM4 (&lxsim_sercom4)
+
+/*!
+@class SERCOM
+@abstract
+   Subset of the Arduino SERCOM wrapper used by the driver.
+*/
+class SERCOM {
+  public:
+	SERCOM( Sercom* s ) : sercom(s) {}
+	bool    isFrameErrorUART( void );
+	void    clearFrameErrorUART( void );
+	uint8_t readDataUART( void );
+	bool    isUARTError( void );
+	void    acknowledgeUARTError( void );
+	void    clearStatusUART( void );
+	Sercom* sercom;
+};
+
+extern SERCOM sercom2;
+extern SERCOM sercom4;
+
+class Uart {
+  public:
+	Uart( SERCOM* s, uint8_t pinRX, uint8_t pinTX, SercomRXPad padRX, SercomUartTXPad padTX );
+	void begin( unsigned long baud, uint16_t config );
+	void end( void );
+  private:
+	SERCOM* _sercom;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**************************************************************************/
+/*!
+    @file     Seeed_Arduino_FreeRTOS.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    The part of the FreeRTOS API used by the driver when LXSAMD51DMX_FREERTOS
+    is defined.  There is one task, the program itself, and the scheduler
+    is always running.  A task blocked in xTaskNotifyWait lets the simulation
+    clock run until it is notified or the timeout passes.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef SEEED_ARDUINO_FREERTOS_H
+#define SEEED_ARDUINO_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t      TickType_t;
+
+#define pdFALSE  ( (BaseType_t)0 )
+#define pdTRUE   ( (BaseType_t)1 )
+#define pdPASS   pdTRUE
+#define pdFAIL   pdFALSE
+
+#define configTICK_RATE_HZ               1000
+#define configSUPPORT_STATIC_ALLOCATION  1
+
+#define portMAX_DELAY  ( (TickType_t)0xFFFFFFFF )
+#define pdMS_TO_TICKS(ms) ( (TickType_t)( ( (uint64_t)(ms) * configTICK_RATE_HZ ) / 1000 ) )
+
+#define taskSCHEDULER_SUSPENDED    0
+#define taskSCHEDULER_NOT_STARTED  1
+#define taskSCHEDULER_RUNNING      2
+
+typedef enum {
+	eNoAction = 0,
+	eSetBits,
+	eIncrement,
+	eSetValueWithOverwrite,
+	eSetValueWithoutOverwrite
+} eNotifyAction;
+
+typedef struct LXSimTask {
+	uint32_t value;
+	uint8_t  pending;
+} *TaskHandle_t;
+
+typedef struct LXSimSemaphore {
+	TaskHandle_t holder;
+	uint32_t     count;
+} StaticSemaphore_t, *SemaphoreHandle_t;
+
+BaseType_t   xTaskGetSchedulerState( void );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+void         vTaskDelay( TickType_t ticks );
+
+BaseType_t   xTaskNotifyWait( uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t* value, TickType_t ticks );
+BaseType_t   xTaskNotify( TaskHandle_t task, uint32_t value, eNotifyAction action );
+BaseType_t   xTaskNotifyFromISR( TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken );
+#define portYIELD_FROM_ISR(woken) ( (void)(woken) )
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void );
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t* buffer );
+BaseType_t   xSemaphoreTakeRecursive( SemaphoreHandle_t mutex, TickType_t ticks );
+BaseType_t   xSemaphoreGiveRecursive( SemaphoreHandle_t mutex );
+
+/*!
+ * @brief counts kept by the simulation
+ * @discussion notify_waits is the number of times the task blocked,
+ *             blocked_ns the virtual time it spent blocked
+ */
+typedef struct {
+	uint64_t notify_waits;
+	uint64_t notify_wakes;
+	uint64_t blocked_ns;
+	uint64_t delay_ticks;
+} LXSimRTOSStats;
+
+extern LXSimRTOSStats LXSimRTOS;
+
+#endif
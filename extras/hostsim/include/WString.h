@@ -0,0 +1,35 @@
+/**************************************************************************/
+/*!
+    @file     WString.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Arduino core stand-in
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_WSTRING_H
+#define LXHOSTSIM_WSTRING_H
+
+#include <string.h>
+#include <string>
+
+class String {
+  public:
+	String( void ) {}
+	String( const char* s ) : _s(s ? s : "") {}
+	const char* c_str( void ) const { return _s.c_str(); }
+	unsigned int length( void ) const { return (unsigned int)_s.length(); }
+	bool operator==(const String& o) const { return _s == o._s; }
+  private:
+	std::string _s;
+};
+
+#endif
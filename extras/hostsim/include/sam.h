@@ -0,0 +1,54 @@
+/**************************************************************************/
+/*!
+    @file     sam.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Register model of the SAMD51 PORT output registers.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_SAM_H
+#define LXHOSTSIM_SAM_H
+
+#include <stdint.h>
+
+// writes to OUT, OUTSET and OUTCLR drive the simulated pins, pin n is bit n % 32 of group n / 32
+#define LXSIM_PORT_GROUPS 8
+
+enum LXSimPortRegId {
+	LXSIM_PORT_OUT,
+	LXSIM_PORT_OUTSET,
+	LXSIM_PORT_OUTCLR
+};
+
+struct LXSimPortReg {
+	uint8_t group;
+	uint8_t id;
+	operator uint32_t() const;
+	LXSimPortReg& operator=( uint32_t v );
+};
+
+typedef struct {
+	struct { LXSimPortReg reg; } OUT;
+	struct { LXSimPortReg reg; } OUTSET;
+	struct { LXSimPortReg reg; } OUTCLR;
+} PortGroup;
+
+class LXSimPort {
+  public:
+	LXSimPort( void );
+	PortGroup Group[LXSIM_PORT_GROUPS];
+};
+
+extern LXSimPort LXSimPortRegisters;
+#define PORT (&LXSimPortRegisters)
+
+#endif
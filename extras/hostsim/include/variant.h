@@ -0,0 +1,20 @@
+/**************************************************************************/
+/*!
+    @file     variant.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Arduino core stand-in
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_VARIANT_H
+#define LXHOSTSIM_VARIANT_H
+#endif
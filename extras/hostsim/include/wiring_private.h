@@ -0,0 +1,31 @@
+/**************************************************************************/
+/*!
+    @file     wiring_private.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Arduino core stand-in
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef LXHOSTSIM_WIRING_PRIVATE_H
+#define LXHOSTSIM_WIRING_PRIVATE_H
+
+#include "Arduino.h"
+
+typedef enum {
+	PIO_NOT_A_PIN = -1,
+	PIO_SERCOM = 2,
+	PIO_SERCOM_ALT = 3
+} EPioType;
+
+int pinPeripheral( uint32_t ulPin, EPioType ulPeripheral );
+
+#endif
@@ -0,0 +1,349 @@
+/**************************************************************************/
+/*!
+    @file     benchmark.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Measures DMX and RDM throughput and latency and prints one CSV line per result:
+
+       benchmark,parameter,value,unit
+
+    Results in virtual time (units without "host") depend only on the driver
+    and repeat exactly, so they can be compared between builds.  Results in
+    host time show the cost of the handlers on the machine running the simulation.
+
+    usage: benchmark [quick]
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <time.h>
+#include <vector>
+#include "Arduino.h"
+#include "LXSimulator.h"
+#include "LXSimResponderFarm.h"
+#include "LXSimDiscovery.h"
+#include <LXSAMD51DMX.h>
+#include <rdm/rdm_utility.h>
+#include "LXENTTECSerial.h"
+
+#define DIRECTION_PIN 3
+#define INPUT_GAP_US  100				// mark between received frames
+#define RDM_GETS      20
+
+extern void LX_SERCOM_Handler( void );
+
+static uint64_t hostNs( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void result( const char* benchmark, const char* parameter, double value, const char* unit ) {
+	printf("%s,%s,%.3f,%s\n", benchmark, parameter, value, unit);
+}
+
+static void result( const char* benchmark, uint32_t parameter, double value, const char* unit ) {
+	char p[16];
+	snprintf(p, sizeof(p), "%u", parameter);
+	result(benchmark, p, value, unit);
+}
+
+/*!
+ * @brief counts breaks the driver puts on the line
+ */
+class BreakCounter : public LXSimBusDevice {
+  public:
+	uint32_t breaks = 0;
+	void lineBreak( uint64_t t_ns ) override { (void)t_ns; breaks++; }
+};
+
+// ***** interrupt handler timed in host time *****
+
+static uint64_t isr_host_ns = 0;
+
+static void timedISR( void ) {
+	uint64_t start = hostNs();
+	LX_SERCOM_Handler();
+	isr_host_ns += hostNs() - start;
+}
+
+static void startISRTiming( void ) {
+	isr_host_ns = 0;
+	LXSim.setISR(&timedISR);
+}
+
+static void reportISR( const char* mode, uint64_t virtual_ns ) {
+	LXSim.setISR(&LX_SERCOM_Handler);
+	double seconds = (double)virtual_ns / 1e9;
+	result("isr_rate", mode, LXSim.isr_calls / seconds, "interrupts/s");
+	result("isr_cost", mode, LXSim.isr_calls ? (double)isr_host_ns / LXSim.isr_calls : 0, "host_ns/interrupt");
+	result("isr_share", mode, 100.0 * isr_host_ns / virtual_ns, "host_percent");
+}
+
+// ***** output frame rate versus slots *****
+
+static void outputRate( uint16_t slots ) {
+	LXSim.reset();
+	BreakCounter line;
+	LXSim.attach(&line);
+	SAMD51DMX.setMaxSlots(slots);
+	SAMD51DMX.startOutput();
+	delay(1000);
+	SAMD51DMX.stop();
+	result("output_rate", slots, line.breaks, "frames/s");
+}
+
+// ***** input frame end to data received callback *****
+
+static std::vector<uint64_t> frame_end_ns;
+static uint64_t latency_total_ns;
+static uint64_t latency_max_ns;
+static uint32_t callbacks;
+
+static void latencyCallback( int slots ) {
+	(void)slots;
+	uint64_t now = LXSim.now();
+	for (size_t n=frame_end_ns.size(); n>0; n--) {		// most recent frame that has ended
+		if ( frame_end_ns[n-1] <= now ) {
+			uint64_t latency = now - frame_end_ns[n-1];
+			latency_total_ns += latency;
+			if ( latency > latency_max_ns ) {
+				latency_max_ns = latency;
+			}
+			callbacks++;
+			break;
+		}
+	}
+}
+
+static void inputLatency( uint16_t slots, uint32_t frames, uint8_t time_isr ) {
+	LXSim.reset();
+	frame_end_ns.clear();
+	latency_total_ns = 0;
+	latency_max_ns = 0;
+	callbacks = 0;
+	uint8_t frame[DMX_MAX_FRAME];
+	memset(frame, 0, DMX_MAX_FRAME);
+	SAMD51DMX.setDataReceivedCallback(&latencyCallback);
+	SAMD51DMX.startInput();
+	if ( time_isr ) {
+		startISRTiming();
+	}
+	uint64_t t0 = LXSim.now();
+	for (uint32_t n=0; n<frames; n++) {
+		frame[1] = n;
+		uint64_t end = LXSim.replyEndTime(slots+1, 1, LXSim.now());
+		frame_end_ns.push_back(end);
+		LXSim.transmitToUSART(frame, slots+1, 1, LXSim.now());
+		LXSim.advance(end - LXSim.now() + INPUT_GAP_US * LXSIM_NS_PER_US);
+	}
+	LXSim.transmitToUSART(frame, 1, 1, LXSim.now());	// a frame shorter than 512 slots ends at the next break
+	LXSim.advance(LXSim.replyEndTime(1, 1, LXSim.now()) - LXSim.now());
+	if ( time_isr ) {
+		reportISR("input_512", LXSim.now() - t0);
+	}
+	SAMD51DMX.stop();
+	SAMD51DMX.setDataReceivedCallback(0);
+	result("input_callbacks", slots, 100.0 * callbacks / frames, "percent");
+	result("input_latency_mean", slots, callbacks ? (double)latency_total_ns / callbacks / LXSIM_NS_PER_US : 0, "us");
+	result("input_latency_max", slots, (double)latency_max_ns / LXSIM_NS_PER_US, "us");
+}
+
+// ***** interrupt load of one universe of output *****
+
+static void outputLoad( void ) {
+	LXSim.reset();
+	SAMD51DMX.setMaxSlots(DMX_MAX_SLOTS);
+	SAMD51DMX.startOutput();
+	startISRTiming();
+	uint64_t t0 = LXSim.now();
+	delay(1000);
+	reportISR("output_512", LXSim.now() - t0);
+	SAMD51DMX.stop();
+}
+
+// ***** RDM GET round trip with DMX output running *****
+
+static void rdmRoundTrip( uint16_t slots, uint8_t time_isr ) {
+	LXSim.reset();
+	LXSimResponderFarm farm;
+	farm.add(0x6C7800000001ull, 176);
+	LXSim.attach(&farm);
+	LXSim.setDirectionPin(DIRECTION_PIN);
+	SAMD51DMX.setMaxSlots(slots);
+	SAMD51DMX.startRDM(DIRECTION_PIN, RDM_DIRECTION_OUTPUT);
+	delay(30);
+	SAMD51DMX.resetBusStats();
+
+	UID target(0x6C, 0x78, 0x00, 0x00, 0x00, 0x01);
+	uint8_t info[RDM_MAX_PDL];
+	uint64_t total = 0;
+	uint64_t max = 0;
+	uint32_t acked = 0;
+	if ( time_isr ) {
+		startISRTiming();
+	}
+	uint64_t t0 = LXSim.now();
+	for (int n=0; n<RDM_GETS; n++) {
+		uint64_t start = LXSim.now();
+		if ( SAMD51DMX.sendRDMGetCommand(&target, RDM_DEVICE_INFO, info, 0) ) {
+			acked++;
+		}
+		uint64_t elapsed = LXSim.now() - start;
+		total += elapsed;
+		if ( elapsed > max ) {
+			max = elapsed;
+		}
+	}
+	if ( time_isr ) {
+		reportISR("rdm_controller", LXSim.now() - t0);
+	}
+	LXDMXBusStats stats;
+	SAMD51DMX.getBusStats(&stats);
+	SAMD51DMX.stop();
+	result("rdm_get_acked", slots, 100.0 * acked / RDM_GETS, "percent");
+	result("rdm_get_mean", slots, (double)total / RDM_GETS / LXSIM_NS_PER_US, "us");
+	result("rdm_get_max", slots, (double)max / LXSIM_NS_PER_US, "us");
+	result("rdm_turnaround_min", slots, stats.min_turnaround_us, "us");
+	result("rdm_turnaround_max", slots, stats.max_turnaround_us, "us");
+}
+
+// ***** full discovery versus number of responders *****
+
+static void discoveryTime( uint16_t count ) {
+	LXSim.reset();
+	LXSimResponderFarm farm(count);
+	farm.addRandom(count / 2, 0x6C78, 176, 2000);
+	farm.addRandom(count - count / 2, 0x6574, 176, 2000);
+	LXSim.attach(&farm);
+	LXSim.setDirectionPin(DIRECTION_PIN);
+	SAMD51DMX.setMaxSlots(DMX_MAX_SLOTS);
+	SAMD51DMX.startRDM(DIRECTION_PIN, RDM_DIRECTION_OUTPUT);
+	delay(30);
+
+	uint64_t host = hostNs();
+	uint64_t t0 = LXSim.now();
+	LXSimDiscovery discovery;
+	discovery.run(&farm);
+	uint64_t elapsed = LXSim.now() - t0;
+	host = hostNs() - host;
+	SAMD51DMX.stop();
+	result("discovery_found", count, 100.0 * discovery.found.size() / count, "percent");
+	result("discovery_branches", count, discovery.branches, "packets");
+	result("discovery_time", count, (double)elapsed / LXSIM_NS_PER_MS, "ms");
+	result("discovery_host", count, (double)host / LXSIM_NS_PER_MS, "host_ms");
+}
+
+// ***** ENTTEC USB *****
+
+static void enttecSendDMX( uint32_t packets ) {
+	LXSim.reset();
+	LXENTTECSerial eSerial;
+	SAMD51DMX.setMaxSlots(DMX_MAX_SLOTS);
+	SAMD51DMX.startOutput();
+	for (uint32_t n=0; n<packets; n++) {
+		LXSim.serial_in.push_back(0x7E);
+		LXSim.serial_in.push_back(ENTTEC_LABEL_SEND_DMX);
+		LXSim.serial_in.push_back(DMX_MAX_FRAME & 0xFF);
+		LXSim.serial_in.push_back(DMX_MAX_FRAME >> 8);
+		for (int s=0; s<DMX_MAX_FRAME; s++) {
+			LXSim.serial_in.push_back(s ? ( n + s ) & 0xFF : 0);
+		}
+		LXSim.serial_in.push_back(0xE7);
+	}
+	size_t bytes = LXSim.serial_in.size();
+	uint32_t accepted = 0;
+	uint64_t host = hostNs();
+	while ( ! LXSim.serial_in.empty() ) {
+		if ( eSerial.readPacket() == ENTTEC_LABEL_SEND_DMX ) {
+			accepted++;
+		}
+	}
+	host = hostNs() - host;
+	SAMD51DMX.stop();
+	result("enttec_send_dmx_accepted", "512", 100.0 * accepted / packets, "percent");
+	result("enttec_send_dmx_parse", "512", (double)bytes * 1000.0 / host, "host_MB/s");
+}
+
+static volatile int got_dmx = 0;
+
+static void gotDMXCallback( int slots ) {
+	got_dmx = slots;
+}
+
+static void enttecReceiveDMX( uint32_t frames ) {
+	LXSim.reset();
+	LXENTTECSerial eSerial;
+	uint8_t frame[DMX_MAX_FRAME];
+	uint8_t buffer[DMX_MAX_FRAME];
+	memset(frame, 0, DMX_MAX_FRAME);
+	got_dmx = 0;
+	SAMD51DMX.setDataReceivedCallback(&gotDMXCallback);
+	SAMD51DMX.startInput();
+
+	uint64_t t0 = LXSim.now();
+	uint64_t next_frame = t0;
+	uint64_t frame_end = 0;
+	uint32_t sent = 0;
+	uint32_t written = 0;
+	uint32_t calls = LXSim.serial_write_calls;
+	while ( sent < frames || LXSim.now() < next_frame ) {
+		if ( ( sent < frames ) && ( LXSim.now() >= next_frame ) ) {
+			frame[1] = sent++;
+			frame_end = LXSim.replyEndTime(DMX_MAX_FRAME, 1, LXSim.now());
+			LXSim.transmitToUSART(frame, DMX_MAX_FRAME, 1, LXSim.now());
+			next_frame = frame_end + INPUT_GAP_US * LXSIM_NS_PER_US;
+		}
+		if ( got_dmx ) {							// as the DMXUSBSerial sketch's doInputMode()
+			int msg_size = got_dmx + 1;
+			got_dmx = 0;
+			if ( SAMD51DMX.copyReceivedSlots(buffer, 0, msg_size) ) {
+				eSerial.writeDMXPacket(buffer, msg_size);
+				written++;
+			}
+		}
+		delayMicroseconds(10);						// rest of loop()
+	}
+	uint64_t elapsed = LXSim.now() - t0;
+	SAMD51DMX.stop();
+	SAMD51DMX.setDataReceivedCallback(0);
+	result("enttec_received_dmx_packets", "512", 100.0 * written / frames, "percent");
+	result("enttec_received_dmx_rate", "512", LXSim.serial_out.size() * 1e9 / elapsed, "bytes/s");
+	result("enttec_received_dmx_writes", "512", written ? (double)( LXSim.serial_write_calls - calls ) / written : 0, "writes/packet");
+}
+
+int main( int argc, char** argv ) {
+	uint8_t quick = ( argc > 1 ) && ( strcmp(argv[1], "quick") == 0 );
+
+	printf("benchmark,parameter,value,unit\n");
+
+	uint16_t slots[] = { 24, 64, 128, 256, 512 };
+	for (size_t i=0; i<sizeof(slots)/sizeof(slots[0]); i++) {
+		outputRate(slots[i]);
+	}
+
+	inputLatency(24, 44, 0);
+	inputLatency(128, 44, 0);
+	inputLatency(512, 44, 1);
+	outputLoad();
+
+	rdmRoundTrip(24, 0);
+	rdmRoundTrip(512, 1);
+
+	uint16_t counts[] = { 1, 10, 100, 500, 1000 };
+	size_t ncounts = quick ? 3 : sizeof(counts)/sizeof(counts[0]);
+	for (size_t i=0; i<ncounts; i++) {
+		discoveryTime(counts[i]);
+	}
+
+	enttecSendDMX(quick ? 100 : 1000);
+	enttecReceiveDMX(44);
+	return 0;
+}
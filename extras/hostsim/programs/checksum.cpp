@@ -0,0 +1,61 @@
+/**************************************************************************/
+/*!
+    @file     checksum.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Checks rdmChecksumBulk against rdmChecksum and a plain byte sum
+    for every alignment and for lengths past 255 bytes.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <rdm/rdm_utility.h>
+
+#define CHECK_MAX_LEN 1100
+
+static uint16_t byteSum( const uint8_t* bytes, uint16_t len ) {
+	uint16_t rv = 0;
+	for (uint16_t j=0; j<len; j++) {
+		rv += bytes[j];
+	}
+	return rv;
+}
+
+int main( void ) {
+	static uint8_t buffer[CHECK_MAX_LEN + 4];
+	srand(1);
+	for (int j=0; j<(int)sizeof(buffer); j++) {
+		buffer[j] = rand();
+	}
+	for (int j=100; j<800; j++) {				// a run of 0xFF pushes the lanes towards their limit
+		buffer[j] = 0xFF;
+	}
+
+	int failed = 0;
+	int checked = 0;
+	for (int offset=0; offset<4; offset++) {
+		for (int len=0; len<=CHECK_MAX_LEN; len++) {
+			uint8_t* bytes = &buffer[offset];
+			uint16_t expected = ( len <= 255 ) ? rdmChecksum(bytes, len) : byteSum(bytes, len);
+			uint16_t bulk = rdmChecksumBulk(bytes, len);
+			checked++;
+			if ( bulk != expected ) {
+				if ( failed < 10 ) {
+					printf("offset %d length %d: rdmChecksumBulk %04x expected %04x\n", offset, len, bulk, expected);
+				}
+				failed++;
+			}
+		}
+	}
+	printf("checksum %d of %d lengths match\n", checked - failed, checked);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+/**************************************************************************/
+/*!
+    @file     discovery.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Discovers farms of 1 to 1000 simulated responders with sendRDMDiscoveryPacket
+    and sendRDMDiscoveryMute and reports virtual time, transactions and
+    whether every responder was found.
+
+    usage: discovery [count] [dropout] [aligned]
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <time.h>
+#include "Arduino.h"
+#include "LXSimulator.h"
+#include "LXSimResponderFarm.h"
+#include "LXSimDiscovery.h"
+#include <LXSAMD51DMX.h>
+#include <rdm/rdm_utility.h>
+
+#define DIRECTION_PIN 3
+
+static void run( uint16_t count, float dropout, uint8_t aligned ) {
+	LXSim.reset();
+	LXSimResponderFarm farm(count);
+	farm.addRandom(count / 2, 0x6C78, 176, 2000, dropout);
+	farm.addRandom(count - count / 2, 0x6574, 176, 2000, dropout);
+	farm.setCollisionMode(aligned ? LXSIM_COLLIDE_ALIGNED : LXSIM_COLLIDE_JITTER);
+	LXSim.attach(&farm);
+	LXSim.setDirectionPin(DIRECTION_PIN);
+
+	SAMD51DMX.startRDM(DIRECTION_PIN, RDM_DIRECTION_OUTPUT);
+	delay(30);
+
+	clock_t start = clock();
+	uint64_t t0 = LXSim.now();
+	LXSimDiscovery discovery;
+	discovery.run(&farm);
+	uint64_t virtual_ms = ( LXSim.now() - t0 ) / LXSIM_NS_PER_MS;
+	SAMD51DMX.stop();
+
+	printf("%5u devices  found %5u  muted %5u  wrong %u  %6u branches %6u mutes  collisions %7llu  %7llu ms  (%.0f ms host)\n",
+			count, (uint32_t)discovery.found.size(), farm.mutedCount(), discovery.false_found, discovery.branches, discovery.mutes,
+			(unsigned long long)LXSim.rx_collisions, (unsigned long long)virtual_ms,
+			( clock() - start ) * 1000.0 / CLOCKS_PER_SEC);
+}
+
+int main( int argc, char** argv ) {
+	float dropout = ( argc > 2 ) ? atof(argv[2]) : 0.0;
+	uint8_t aligned = ( argc > 3 ) ? atoi(argv[3]) : 0;
+	if ( argc > 1 ) {
+		run(atoi(argv[1]), dropout, aligned);
+		return 0;
+	}
+	uint16_t counts[] = { 1, 10, 100, 500, 1000 };
+	for (size_t i=0; i<sizeof(counts)/sizeof(counts[0]); i++) {
+		run(counts[i], dropout, aligned);
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+/**************************************************************************/
+/*!
+    @file     timing.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    Host simulation for LXSAMD51DMX
+
+    Runs the unchanged driver against the simulated SERCOM and reports
+    output frame rate, input frames and RDM line turnaround in virtual time.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <time.h>
+#include "Arduino.h"
+#include "LXSimulator.h"
+#include "LXSimResponderFarm.h"
+#include <LXSAMD51DMX.h>
+#include <rdm/rdm_utility.h>
+
+#define DIRECTION_PIN 3
+
+/*!
+ * @brief counts what the driver puts on the line
+ */
+class LineCounter : public LXSimBusDevice {
+  public:
+	uint32_t breaks = 0;
+	uint32_t bytes = 0;
+	uint32_t frame_bytes = 0;
+	uint32_t last_frame_bytes = 0;
+	void lineBreak( uint64_t t_ns ) override { (void)t_ns; breaks++; last_frame_bytes = frame_bytes; frame_bytes = 0; }
+	void lineByte( uint8_t c, uint64_t t_ns ) override { (void)c; (void)t_ns; bytes++; frame_bytes++; }
+};
+
+static volatile int frames_received = 0;
+
+void gotDMXCallback( int slots ) {
+	(void)slots;
+	frames_received++;
+}
+
+static double hostMs( clock_t start ) {
+	return ( clock() - start ) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int main( void ) {
+	// ----- output: one second of DMX -----
+	clock_t start = clock();
+	LineCounter line;
+	LXSim.attach(&line);
+	SAMD51DMX.startOutput();
+	delay(1000);
+	SAMD51DMX.stop();
+	printf("output  %u frames/s, %u bytes/s, %u bytes per frame, %llu interrupts (%.1f ms host)\n",
+			line.breaks, line.bytes, line.last_frame_bytes, (unsigned long long)LXSim.isr_calls, hostMs(start));
+
+	// ----- input: 44 frames sent to the receiver -----
+	LXSim.reset();
+	start = clock();
+	uint8_t frame[DMX_MAX_FRAME];
+	memset(frame, 0, DMX_MAX_FRAME);
+	SAMD51DMX.setDataReceivedCallback(&gotDMXCallback);
+	SAMD51DMX.startInput();
+	for (int n=0; n<44; n++) {
+		frame[1] = n;
+		LXSim.transmitToUSART(frame, DMX_MAX_FRAME, 1, LXSim.now());
+		LXSim.advance(LXSim.replyEndTime(DMX_MAX_FRAME, 1, LXSim.now()) - LXSim.now() + 100 * LXSIM_NS_PER_US);
+	}
+	delay(1);							// the last frame ends at the next break or when idle
+	SAMD51DMX.stop();
+	SAMD51DMX.setDataReceivedCallback(0);
+	printf("input   %d of 44 frames, slot 1 = %d (%.1f ms host)\n", frames_received, SAMD51DMX.getSlot(1), hostMs(start));
+
+	// ----- RDM: request to one responder, measure turnaround -----
+	LXSim.reset();
+	start = clock();
+	LXSimResponderFarm farm;
+	farm.add(0x6C7800000001ull, 176);
+	LXSim.attach(&farm);
+	LXSim.setDirectionPin(DIRECTION_PIN);
+	SAMD51DMX.startRDM(DIRECTION_PIN, RDM_DIRECTION_OUTPUT);
+	delay(30);
+	SAMD51DMX.resetBusStats();
+	UID target(0x6C, 0x78, 0x00, 0x00, 0x00, 0x01);
+	uint8_t info[4];
+	uint64_t t0 = LXSim.now();
+	uint8_t rv = SAMD51DMX.sendRDMGetCommand(&target, RDM_DEVICE_INFO, info, 4);
+	uint64_t elapsed = LXSim.now() - t0;
+	delay(5);							// the line is taken back for the next DMX frame
+	LXDMXBusStats stats;
+	SAMD51DMX.getBusStats(&stats);
+	SAMD51DMX.stop();
+	printf("rdm     result %d in %llu us, response end to line taken %u-%u us, %llu direction changes (%.1f ms host)\n",
+			rv ? 1 : SAMD51DMX.lastRDMResult(), (unsigned long long)(elapsed / LXSIM_NS_PER_US),
+			stats.min_turnaround_us, stats.max_turnaround_us, (unsigned long long)LXSim.direction_changes, hostMs(start));
+	return 0;
+}
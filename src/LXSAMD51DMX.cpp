@@ -20,6 +20,9 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <rdm/rdm_utility.h>
+#include <rdm/RDMMessageQueue.h>
+#include <rdm/RDMResponseCache.h>
+#include <rdm/RDMDeviceStats.h>
 
 //**************************************************************************************
 // single instance and shared interrupt status
@@ -32,23 +35,83 @@ uint8_t  _interrupt_mode;
 
 // **************************** SERCOMn_Handler  ***************
 // 
+#if defined LXSAMD51DMX_PROFILE
+/*!
+ * @brief samples the DWT cycle counter on construction and records the elapsed cycles when it goes out of scope
+ */
+class LXProfileScope {
+  public:
+	LXProfileScope( uint8_t handler ) : _handler(handler), _start(DWT->CYCCNT) {}
+	~LXProfileScope( void ) {
+		SAMD51DMX.recordProfile(_handler, DWT->CYCCNT - _start);
+	}
+  private:
+	uint8_t  _handler;
+	uint32_t _start;
+};
+#define LX_PROFILE(handler) LXProfileScope lx_profile_scope(handler)
+#else
+#define LX_PROFILE(handler)
+#endif
+
+#if defined LXSAMD51DMX_TRACE
+#define LX_TRACE(event, data) SAMD51DMX.traceEvent(event, data)
+#else
+#define LX_TRACE(event, data)
+#endif
+
+#if defined LXSAMD51DMX_FREERTOS && LXSAMD51DMX_RDM
+/*!
+ * @brief holds the bus for the calling task until it goes out of scope
+ */
+class LXBusLock {
+  public:
+	LXBusLock( void ) { SAMD51DMX.lockBus(); }
+	~LXBusLock( void ) { SAMD51DMX.unlockBus(); }
+};
+#define LX_BUS_LOCK() LXBusLock lx_bus_lock
+#define LX_WAIT_FOR_ISR(poll) do { if ( ! waitForISR() ) { poll; } } while (0)
+#define LX_WAKE_BUS() wakeBusOwner()
+#define LX_SLEEP_MS(ms) sleepMS(ms)
+#else
+#define LX_BUS_LOCK()
+#define LX_WAIT_FOR_ISR(poll) poll
+#define LX_WAKE_BUS()
+#define LX_SLEEP_MS(ms) delay(ms)
+#endif
+
 // DMX_SERCOM_HANDLER_FUNC macro points to handler name
 
 void DMX_SERCOM_HANDLER_FUNC()
 {
+	LX_PROFILE(LX_PROFILE_ISR);
 	switch ( _interrupt_mode ) {
+#if LXSAMD51DMX_OUTPUT
 		case ISR_OUTPUT_ENABLED:
 			SAMD51DMX.outputIRQHandler();
 			break;
+#endif
+#if LXSAMD51DMX_INPUT
 		case ISR_INPUT_ENABLED:
 			SAMD51DMX.inputIRQHandler();
 			break;
+#endif
+#if LXSAMD51DMX_RDM
 		case ISR_RDM_ENABLED:
 			SAMD51DMX.rdmIRQHandler();
 			break;
+#endif
 	}
 }
 
+#if LXSAMD51DMX_INPUT
+// callbacks deferred by setCallbackMode(LX_CALLBACK_DEFERRED)
+void LXSAMD51DMX_DEFER_HANDLER()
+{
+	SAMD51DMX.runDeferredCallbacks();
+}
+#endif
+
 #if defined( use_optional_sercom_macros )
 	#warning use_optional_sercom_macros
 	
@@ -119,13 +182,78 @@ void setBaudRate(uint32_t baudrate) {
 
 LXSAMD51DMX::LXSAMD51DMX ( void ) {
 	_direction_pin = DIRECTION_PIN_NOT_USED;	//optional
-	_slots = DMX_MAX_SLOTS;
+	_direction_port = &PORT->Group[0];
+	_direction_mask = 0;
+	_slots = LXSAMD51DMX_MAX_SLOTS;
+	_packet_length = LXSAMD51DMX_RECEIVE_SIZE;
 	_interrupt_mode = ISR_DISABLED;
 	_receive_callback = NULL;
 	_rdm_receive_callback = NULL;
+#if LXSAMD51DMX_RDM
+	_rdm_send_buffer = _rdmPacket;
+	_rdm_auto_discovery = 0;
+	_rdm_discovery_muted = 0;
+	_rdm_message_queue = NULL;
+	_rdm_cache = NULL;
+	_rdm_device_stats = NULL;
+	_rdm_result = RDM_RESULT_NONE;
+	_rdm_nack_reason = 0;
+	_rdm_retries = RDM_DEFAULT_RETRIES;
+	_rdm_backoff_ms = RDM_DEFAULT_BACKOFF_MS;
+	_rdm_reply_slots = 0;
+	_rdm_response_ready = 0;
+	_rdm_async_pending = 0;
+	_rdm_received_len = 0;
+	_dmx_min_period_us = 0;
+	_rdm_cost_us = RDM_TRANSACTION_INITIAL_US;
+	_rdm_deferred_frames = 0;
+	_guard_slots = 0;
+	_turnaround_us = RDM_TURNAROUND_MIN_US;
+	_rdm_rx_end_us = 0;
+	_rdm_rx_end_valid = 0;
+#endif
+	_last_dmx_start_us = 0;
+	memset(&_bus_stats, 0, sizeof(LXDMXBusStats));
+	_bus_stats_start_ms = 0;
+#if LXSAMD51DMX_INPUT
+	_frame_sequence = 0;
+	_callback_mode = LX_CALLBACK_DIRECT;
+	_deferred_events = 0;
+	_deferred_slots = 0;
+	_deferred_rdm_len = 0;
+#endif
+#if defined LXSAMD51DMX_FREERTOS
+#if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+	_bus_mutex = xSemaphoreCreateRecursiveMutexStatic(&_bus_mutex_buffer);
+#else
+	_bus_mutex = xSemaphoreCreateRecursiveMutex();
+#endif
+	_bus_owner = NULL;
+	_bus_lock_depth = 0;
+	_rdm_async_locked = 0;
+	_notify_task = NULL;
+#endif
+#if defined LXSAMD51DMX_PROFILE
+	resetProfile();
+#endif
+#if defined LXSAMD51DMX_TRACE
+	_trace_head = 0;
+	_trace_tail = 0;
+	_trace_dropped = 0;
+#endif
 	
-	//zero buffer including _dmxData[0] which is start code
-    memset(_dmxData, 0, DMX_MAX_SLOTS+1);
+	//zero buffers including _dmxData[0] which is start code
+    memset(_dmx_buffers, 0, sizeof(_dmx_buffers));
+    _dmxData = _dmx_buffers[0];
+#if LXSAMD51DMX_OUTPUT
+    _dmx_ready = _dmx_buffers[1];
+    _dmx_back = _dmx_buffers[2];
+#else
+    _dmx_ready = NULL;
+    _dmx_back = NULL;
+#endif
+    _dmx_ready_flag = 0;
+    _dmx_ready_slots = 0;
 }
     
 
@@ -135,10 +263,9 @@ LXSAMD51DMX::~LXSAMD51DMX ( void ) {
 }
 
 
+#if LXSAMD51DMX_OUTPUT
 void LXSAMD51DMX::startOutput ( void ) {
-	if ( _direction_pin != DIRECTION_PIN_NOT_USED ) {
-		digitalWrite(_direction_pin, HIGH);
-	}
+	setDirection(HIGH);
 
 	if ( _interrupt_mode == ISR_INPUT_ENABLED ) {
 		stop();
@@ -146,6 +273,9 @@ void LXSAMD51DMX::startOutput ( void ) {
 	
 	if ( _interrupt_mode == ISR_DISABLED ) {	//prevent messing up sequence if already started...
 	  SerialDMX.begin(DMX_BREAK_BAUD, (uint8_t)SERIAL_8N2);
+#if LXSAMD51DMX_INPUT
+	  setInterruptPriorities();
+#endif
   
 	  // Assign pin mux to SERCOM functionality (must come after SerialDMX.begin)
 	  pinPeripheral(PIN_DMX_RX, MUX_DMX_RX);
@@ -161,16 +291,17 @@ void LXSAMD51DMX::startOutput ( void ) {
 	  transmissionComplete();	//sets TXC interrupt and sends break
 	}
 }
+#endif
 
+#if LXSAMD51DMX_INPUT
 void LXSAMD51DMX::startInput ( void ) {
-	if ( _direction_pin != DIRECTION_PIN_NOT_USED ) {
-		digitalWrite(_direction_pin, LOW);
-	}
+	setDirection(LOW);
 	if ( _interrupt_mode == ISR_OUTPUT_ENABLED ) {
 		stop();
 	}
 	if ( _interrupt_mode == ISR_DISABLED ) {	//prevent messing up sequence if already started...
 		SerialDMX.begin(DMX_DATA_BAUD, (uint8_t)SERIAL_8N2);
+		setInterruptPriorities();
   
 	   // Assign pin mux to SERCOM functionality (must come after SerialDMX.begin)
 	   pinPeripheral(PIN_DMX_RX, MUX_DMX_RX);
@@ -182,10 +313,11 @@ void LXSAMD51DMX::startInput ( void ) {
 		_interrupt_mode = ISR_INPUT_ENABLED;
 	}
 }
+#endif
 
+#if LXSAMD51DMX_RDM
 void LXSAMD51DMX::startRDM( uint8_t pin, uint8_t direction ) {
-	pinMode(pin, OUTPUT);
-	_direction_pin = pin;
+	setDirectionPin(pin);
 	if ( direction ) {
 		startOutput();							//enables transmit interrupt
 		_next_read_slot = 0;              
@@ -197,19 +329,43 @@ void LXSAMD51DMX::startRDM( uint8_t pin, uint8_t direction ) {
 	}
 	_interrupt_mode = ISR_RDM_ENABLED;
 }
+#endif
 
 void LXSAMD51DMX::stop ( void ) {
    SerialDMX.end();
 	_interrupt_mode = ISR_DISABLED;
+#if LXSAMD51DMX_RDM
+	if ( _rdm_async_pending ) {				// abandon request started with startRDMControllerPacket
+		_rdm_async_pending = 0;
+		_rdm_read_handled = 0;
+	}
+#endif
 }
 
 void LXSAMD51DMX::setDirectionPin( uint8_t pin ) {
 	_direction_pin = pin;
+	if ( pin == DIRECTION_PIN_NOT_USED ) {
+		_direction_port = &PORT->Group[0];
+		_direction_mask = 0;						// writes change nothing
+		return;
+	}
 	pinMode(_direction_pin, OUTPUT);
+	_direction_port = &PORT->Group[g_APinDescription[pin].ulPort];
+	_direction_mask = 1ul << g_APinDescription[pin].ulPin;
+}
+
+void LXSAMD51DMX::setDirection( uint8_t level ) {
+	if ( level ) {
+		_direction_port->OUTSET.reg = _direction_mask;
+	} else {
+		_direction_port->OUTCLR.reg = _direction_mask;
+	}
 }
 
 void LXSAMD51DMX::setMaxSlots (int slots) {
-	if ( slots > DMX_MIN_SLOTS ) {
+	if ( slots > LXSAMD51DMX_MAX_SLOTS ) {
+		_slots = LXSAMD51DMX_MAX_SLOTS;
+	} else if ( slots > DMX_MIN_SLOTS ) {
 		_slots = slots;
 	} else {
 		_slots = DMX_MIN_SLOTS;
@@ -220,37 +376,142 @@ uint8_t LXSAMD51DMX::getSlot (int slot) {
 	return _dmxData[slot];
 }
 
+#if LXSAMD51DMX_OUTPUT
 void LXSAMD51DMX::setSlot (int slot, uint8_t value) {
 	_dmxData[slot] = value;
 }
+#endif
 
 uint8_t* LXSAMD51DMX::dmxData(void) {
 	return &_dmxData[0];
 }
 
+#if LXSAMD51DMX_OUTPUT
+uint8_t* LXSAMD51DMX::dmxBackBuffer(void) {
+	return _dmx_back;
+}
+
+void LXSAMD51DMX::commitDMXBackBuffer(uint16_t slots) {
+	if ( slots > LXSAMD51DMX_MAX_SLOTS ) {
+		slots = LXSAMD51DMX_MAX_SLOTS;
+	} else if ( slots && ( slots < DMX_MIN_SLOTS ) ) {
+		slots = DMX_MIN_SLOTS;
+	}
+	noInterrupts();							// the ISR takes _dmx_ready at the break
+	uint8_t* committed = _dmx_back;
+	_dmx_back = _dmx_ready;					// not sent yet or already replaced, free to refill
+	_dmx_ready = committed;
+	_dmx_ready_slots = slots;
+	_dmx_ready_flag = 1;
+	interrupts();
+}
+#endif
+
+#if LXSAMD51DMX_RDM
 uint8_t* LXSAMD51DMX::rdmData( void ) {
 	return _rdmPacket;
 }
 
+uint8_t* LXSAMD51DMX::receivedRDMData( void ) {
+	return _rdmData;
+}
+#endif
+
+#if LXSAMD51DMX_INPUT
 uint8_t* LXSAMD51DMX::receivedData( void ) {
 	return _receivedData;
 }
 
-uint8_t* LXSAMD51DMX::receivedRDMData( void ) {
-	return _rdmData;
+uint32_t LXSAMD51DMX::frameSequence( void ) {
+	return _frame_sequence >> 1;
+}
+
+uint8_t LXSAMD51DMX::newFrameSince( uint32_t sequence ) {
+	return ( frameSequence() != sequence );
+}
+
+uint8_t LXSAMD51DMX::copyReceivedSlots( uint8_t* dest, uint16_t start, uint16_t count, uint32_t* sequence ) {
+	if ( ( start + count ) > LXSAMD51DMX_MAX_FRAME ) {
+		return 0;
+	}
+	for (uint8_t attempt=0; attempt<DMX_SNAPSHOT_RETRIES; attempt++) {
+		uint32_t before = _frame_sequence;
+		if ( before & 1 ) {							// only seen from a context that interrupted the ISR
+			continue;
+		}
+		__asm__ __volatile__ ("" ::: "memory");		// sequence is read before the slots
+		memcpy(dest, &_dmxData[start], count);
+		__asm__ __volatile__ ("" ::: "memory");		// slots are read before the sequence is checked
+		if ( _frame_sequence == before ) {
+			if ( sequence != NULL ) {
+				*sequence = before >> 1;
+			}
+			return 1;
+		}
+	}
+	return 0;
 }
+#endif
 
 //************************************************************************************
 
+#if LXSAMD51DMX_OUTPUT
 void LXSAMD51DMX::transmissionComplete( void ) {
+	LX_PROFILE(LX_PROFILE_TX_COMPLETE);
+#if LXSAMD51DMX_RDM
+	if ( _dmx_send_state == DMX_STATE_GUARD ) {				// turnaround has elapsed, take the line
+		takeLine();
+		if ( _rdm_send_break ) {
+			_dmx_send_state = DMX_STATE_BREAK;				// continue below to send break
+		} else {											// discovery response is sent without break
+			_dmx_send_state = DMX_STATE_DATA;
+			LX_TRACE(LX_TRACE_RDM_START, _rdm_len | 0x8000);
+			DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_TXC;
+			DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
+			DMX_SERCOM->USART.DATA.reg = nextRDMSlot();
+			return;
+		}
+	}
+#endif
 	if ( _dmx_send_state == DMX_STATE_BREAK ) {
+#if LXSAMD51DMX_RDM
+		if ( _rdm_task_mode == DMX_TASK_SEND_RDM ) {
+			if ( _rdm_read_handled ) {
+				_rdm_start_us = micros();
+				_bus_stats.rdm_transactions++;
+			}
+			LX_TRACE(LX_TRACE_RDM_START, _rdm_len);
+		} else
+#endif
+		{
+			uint32_t now = micros();
+			if ( _bus_stats.dmx_frames && ( ( now - _last_dmx_start_us ) > _bus_stats.max_dmx_interval_us ) ) {
+				_bus_stats.max_dmx_interval_us = now - _last_dmx_start_us;
+			}
+			_last_dmx_start_us = now;
+			_bus_stats.dmx_frames++;
+			if ( _dmx_ready_flag ) {						// committed frame replaces the current one
+				uint8_t* sent = _dmxData;
+				_dmxData = _dmx_ready;
+				_dmx_ready = sent;
+				if ( _dmx_ready_slots ) {
+					_slots = _dmx_ready_slots;
+				}
+				_dmx_ready_flag = 0;
+			}
+			LX_TRACE(LX_TRACE_BREAK_SENT, _slots);
+		}
 		setBaudRate(DMX_BREAK_BAUD);
         _dmx_send_state = DMX_STATE_START;
         _next_send_slot = 0;
+#if LXSAMD51DMX_RDM
+        _rdm_send_checksum = 0;
+#endif
         DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
         DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_TXC;
         DMX_SERCOM->USART.DATA.reg = 0;	//break
 	} else if ( _dmx_send_state == DMX_STATE_IDLE ) {		//after data completely sent
+#if LXSAMD51DMX_RDM
 		if ( _rdm_task_mode == 	DMX_TASK_SEND_RDM ) {
 			DMX_SERCOM->USART.INTFLAG.bit.TXC = 1;						// clear txc interrupt !!!
 			DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_TXC;	// shut off interrupt
@@ -258,20 +519,43 @@ void LXSAMD51DMX::transmissionComplete( void ) {
 			if ( _rdm_read_handled ) {
 				_dmx_read_state = DMX_READ_STATE_START;
 				_next_read_slot = 0;
+				_packet_length = LXSAMD51DMX_RECEIVE_SIZE;	// a discovery response has no break to reset it
+				_rdm_read_checksum = 0;
+				_rdm_read_checksum_len = DMX_MAX_FRAME;
 			} else {
 				_dmx_read_state = DMX_READ_STATE_IDLE;
 			}
-			digitalWrite(_direction_pin, LOW);
+			setDirection(LOW);
+			LX_TRACE(LX_TRACE_DIRECTION, LOW);
+			LX_WAKE_BUS();								// packet sent
 			DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_RXC |  //Received complete
                                          SERCOM_USART_INTENSET_ERROR; //All others errors
-		} else {
+			if ( _rdm_read_handled ) {					// time the response window with filler slots
+				_hold_slots = 0;
+				_rdm_reply_slots = 0;
+				_dmx_send_state = DMX_STATE_LISTEN;
+				LX_TRACE(LX_TRACE_STATE, DMX_STATE_LISTEN);
+				DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
+			}
+		} else
+#endif
+		{
 			_dmx_send_state = DMX_STATE_BREAK;
 			// txc interrupt not cleared so it will fire again...
 			// if necessary, change mode
+#if LXSAMD51DMX_RDM
 			if ( _rdm_task_mode == 	DMX_TASK_SET_SEND_RDM ) {
-				_rdm_task_mode = DMX_TASK_SEND_RDM;
-			} else if ( _rdm_task_mode == DMX_TASK_SET_SEND ) {
+				if ( rdmFitsBeforeDMX() || ( ++_rdm_deferred_frames > RDM_MAX_DEFERRED_FRAMES ) ) {
+					_rdm_task_mode = DMX_TASK_SEND_RDM;
+					_rdm_deferred_frames = 0;
+				} else {
+					_bus_stats.rdm_deferred++;			// another DMX frame first
+				}
+			} else
+#endif
+			if ( _rdm_task_mode == DMX_TASK_SET_SEND ) {
 				_rdm_task_mode = DMX_TASK_SEND;
+				LX_WAKE_BUS();							// DMX resumed
 			}
 		}
 	} else if ( _dmx_send_state == DMX_STATE_START ) {
@@ -280,25 +564,32 @@ void LXSAMD51DMX::transmissionComplete( void ) {
         DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_TXC;
         DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
         	//rdm task (?)
+#if LXSAMD51DMX_RDM
         if ( _rdm_task_mode == DMX_TASK_SEND_RDM ) {
-        	DMX_SERCOM->USART.DATA.reg = _rdmPacket[_next_send_slot++];
-        } else {
+        	DMX_SERCOM->USART.DATA.reg = nextRDMSlot();
+        } else
+#endif
+        {
         	DMX_SERCOM->USART.DATA.reg = _dmxData[_next_send_slot++];
         }
 	}
 }
 
 void LXSAMD51DMX::dataRegisterEmpty( void ) {
+	LX_PROFILE(LX_PROFILE_DATA_EMPTY);
 	if ( _dmx_send_state == DMX_STATE_DATA ) {
+#if LXSAMD51DMX_RDM
 		if ( _rdm_task_mode == 	DMX_TASK_SEND_RDM ) {
-			DMX_SERCOM->USART.DATA.reg = _rdmPacket[_next_send_slot++];	//send next slot;
-			if ( _next_send_slot > _rdm_len ) {
+			DMX_SERCOM->USART.DATA.reg = nextRDMSlot();	//send next slot;
+			if ( _next_send_slot >= _rdm_len ) {			// _rdm_len includes start code
 				_dmx_send_state = DMX_STATE_IDLE;
 				DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
 				DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_TXC;
 				// switch to wait for last byte transmission to complete
 			}
-		} else {
+		} else
+#endif
+		{
 			DMX_SERCOM->USART.DATA.reg = _dmxData[_next_send_slot++];	//send next slot;
 			if ( _next_send_slot > _slots ) {
 				_dmx_send_state = DMX_STATE_IDLE;
@@ -308,11 +599,113 @@ void LXSAMD51DMX::dataRegisterEmpty( void ) {
 			}
 		}
 		
+#if LXSAMD51DMX_RDM
+	} else if ( _dmx_send_state == DMX_STATE_GUARD ) {
+		DMX_SERCOM->USART.DATA.reg = 0xFF;			// line driver is off, this only marks time
+		_guard_slots--;
+		if ( _guard_slots == 0 ) {
+			DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
+			DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_TXC;
+			// switch to wait for last guard slot to complete
+		}
+	} else if ( _dmx_send_state == DMX_STATE_LISTEN ) {	// waiting for response to controller request
+		DMX_SERCOM->USART.DATA.reg = 0xFF;			// line driver is off, this only marks time
+		_hold_slots++;
+		if ( ( _rdm_reply_slots == 0 ) && ( _next_read_slot || ( _dmx_read_state == DMX_READ_STATE_RECEIVING ) ) ) {
+			_rdm_reply_slots = _hold_slots;			// response has started
+			LX_TRACE(LX_TRACE_RESPONSE_START, _hold_slots);
+		}
+		if ( rdmResponseEnded() ) {
+			if ( _next_read_slot ) {
+				LX_TRACE(LX_TRACE_RESPONSE_END, _next_read_slot);
+			} else {
+				LX_TRACE(LX_TRACE_TIMEOUT, _hold_slots);
+			}
+			uint32_t cost = micros() - _rdm_start_us;	// longer transactions count at once, shorter decay the estimate
+			_rdm_cost_us = ( cost > _rdm_cost_us ) ? cost : ( ( 3 * _rdm_cost_us + cost ) >> 2 );
+			_rdm_task_mode = DMX_TASK_SEND;			// input off, response stays in _receivedData
+			_hold_slots = 0;
+			_guard_slots = turnaroundSlots() - 1;	// slot just written counts toward the turnaround
+			_dmx_send_state = DMX_STATE_HOLD;
+			LX_TRACE(LX_TRACE_STATE, DMX_STATE_HOLD);
+			_rdm_response_ready = 1;
+			LX_WAKE_BUS();
+		}
+	} else if ( _dmx_send_state == DMX_STATE_HOLD ) {	// line is free for the next request
+		DMX_SERCOM->USART.DATA.reg = 0xFF;
+		_hold_slots++;
+		if ( _hold_slots >= _guard_slots ) {
+			if ( _dmx_min_period_us == 0 ) {
+				endRDMHold();							// one DMX frame between requests
+			} else if ( ! rdmFitsBeforeDMX() ) {
+				endRDMHold();							// DMX is due
+			} else if ( _rdm_task_mode == DMX_TASK_SET_SEND_RDM ) {
+				_rdm_task_mode = DMX_TASK_SEND_RDM;		// next request back to back
+				endRDMHold();
+			} else if ( _hold_slots >= RDM_GAP_MAX_SLOTS ) {
+				endRDMHold();							// nothing waiting
+			}
+		}
+#endif
 	}
 }
+#endif
+
+#if LXSAMD51DMX_RDM
+void LXSAMD51DMX::endRDMHold( void ) {
+	_rdm_send_break = 1;
+	_dmx_send_state = DMX_STATE_GUARD;				// transmissionComplete enables driver and sends break
+	LX_TRACE(LX_TRACE_STATE, DMX_STATE_GUARD);
+	DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
+	DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_TXC;
+}
+
+uint8_t LXSAMD51DMX::rdmFitsBeforeDMX( void ) {
+	if ( _dmx_min_period_us == 0 ) {
+		return 1;
+	}
+	// transaction plus turnaround before it starts and before the line is given back
+	uint32_t needed = _rdm_cost_us + 2 * _turnaround_us;
+	return ( ( micros() - _last_dmx_start_us ) + needed <= _dmx_min_period_us );
+}
+
+uint8_t LXSAMD51DMX::rdmResponseEnded( void ) {
+	if ( _hold_slots >= RDM_RESPONSE_MAX_SLOTS ) {
+		return 1;
+	}
+	if ( _next_read_slot == 0 ) {						// nothing yet (or only the ignored first byte)
+		if ( _dmx_read_state == DMX_READ_STATE_RECEIVING ) {
+			return ( _hold_slots >= RDM_RESPONSE_START_SLOTS + RDM_DISC_RESPONSE_FRAME );
+		}
+		return ( _hold_slots >= RDM_RESPONSE_START_SLOTS );
+	}
+	if ( _receivedData[0] == RDM_START_CODE ) {
+		return ( _next_read_slot > RDM_IDX_PACKET_SIZE ) && ( ! rdmResponseIncomplete() );
+	}
+	// discovery response, up to 24 slots of which the first is ignored
+	return ( _next_read_slot >= RDM_DISC_RESPONSE_FRAME-2 ) || ( _hold_slots >= RDM_RESPONSE_START_SLOTS + RDM_DISC_RESPONSE_FRAME );
+}
+
+uint8_t LXSAMD51DMX::nextRDMSlot( void ) {
+	uint8_t c;
+	if ( _next_send_slot < _rdm_checksum_slot ) {			// checksum accumulates as bytes go out
+		c = _rdm_send_buffer[_next_send_slot];
+		_rdm_send_checksum += c;
+	} else if ( _next_send_slot == _rdm_checksum_slot ) {	// reached checksum, fill it in
+		c = _rdm_send_checksum >> 8;
+		_rdm_send_buffer[_next_send_slot] = c;
+		_rdm_send_buffer[_next_send_slot+1] = _rdm_send_checksum & 0xFF;
+	} else {
+		c = _rdm_send_buffer[_next_send_slot];
+	}
+	_next_send_slot++;
+	return c;
+}
+#endif
 
 //************************************************************************************
 
+#if LXSAMD51DMX_INPUT
 void LXSAMD51DMX::printReceivedData( void ) {
 	for(int j=0; j<_next_read_slot; j++) {
 		Serial.println(_receivedData[j]);
@@ -320,33 +713,72 @@ void LXSAMD51DMX::printReceivedData( void ) {
 }
 
 void LXSAMD51DMX::packetComplete( void ) {
+	LX_PROFILE(LX_PROFILE_PACKET_COMPLETE);
 	if ( _receivedData[0] == 0 ) {				//zero start code is DMX
 		if ( _rdm_read_handled == 0 ) {			// not handled by specific method
 			if ( _next_read_slot > DMX_MIN_SLOTS ) {
 				_slots = _next_read_slot - 1;				//_next_read_slot represents next slot so subtract one
+				LX_TRACE(LX_TRACE_DMX_RECEIVED, _slots);
+				_frame_sequence++;							// odd while _dmxData is changing
+				__asm__ __volatile__ ("" ::: "memory");
 				for(int j=0; j<_next_read_slot; j++) {	//copy dmx values from read buffer
 					_dmxData[j] = _receivedData[j];
 				}
+				__asm__ __volatile__ ("" ::: "memory");
+				_frame_sequence++;
 	
 				if ( _receive_callback != NULL ) {
-					_receive_callback(_slots);
+					if ( _callback_mode == LX_CALLBACK_DEFERRED ) {
+						deferCallback(LX_DEFERRED_DMX, _slots);
+					} else {
+						_receive_callback(_slots);
+					}
+				}
+#if defined LXSAMD51DMX_FREERTOS
+				if ( _notify_task != NULL ) {
+					notifyTask(_notify_task, LX_NOTIFY_DMX);
 				}
+#endif
 			}
 		}
 	} else {
+#if LXSAMD51DMX_RDM
 		if ( _receivedData[0] == RDM_START_CODE ) {			//zero start code is RDM
 			if ( _rdm_read_handled == 0 ) {					// not handled by specific method
-				if ( validateRDMPacket(_receivedData) ) {	// evaluate checksum
-					uint8_t plen = _receivedData[2] + 2;
+				if ( validateReceivedRDMPacket() ) {		// evaluate checksum
+					LX_TRACE(LX_TRACE_RDM_RECEIVED, _receivedData[2] + 2);
+					_rdm_rx_end_us = micros();				// turnaround for the response starts now
+					_rdm_rx_end_valid = 1;
+					if ( _rdm_auto_discovery && autoRDMDiscovery() ) {
+						resetFrame();						// answered here, not passed to callback
+						return;
+					}
+					uint16_t plen = _receivedData[2] + 2;
+#if ! LXSAMD51DMX_SHARED_RDM_BUFFER
 					for(int j=0; j<plen; j++) {
 						_rdmData[j] = _receivedData[j];
 					}
+#endif
 					if ( _rdm_receive_callback != NULL ) {
-						_rdm_receive_callback(plen);
+						if ( _callback_mode == LX_CALLBACK_DEFERRED ) {
+							deferCallback(LX_DEFERRED_RDM, plen);
+						} else {
+							_rdm_receive_callback(plen);
+						}
 					}
+#if defined LXSAMD51DMX_FREERTOS
+					if ( _notify_task != NULL ) {
+						notifyTask(_notify_task, LX_NOTIFY_RDM);
+					}
+#endif
+				} else {
+					LX_TRACE(LX_TRACE_CHECKSUM_ERROR, _next_read_slot);
 				}
 			}
-		} else {
+		} else
+#endif
+		{
+			LX_TRACE(LX_TRACE_UNKNOWN_PACKET, _receivedData[0]);
 #if defined LXSAMD51DMX_DEBUG
 			Serial.println("________________ unknown data packet ________________");
 			printReceivedData();
@@ -362,6 +794,8 @@ void LXSAMD51DMX::resetFrame( void ) {
 }
 
 void LXSAMD51DMX::breakReceived( void ) {
+	LX_PROFILE(LX_PROFILE_BREAK_RECEIVED);
+	LX_TRACE(LX_TRACE_BREAK_RECEIVED, _next_read_slot);
 	if ( _dmx_read_state == DMX_READ_STATE_RECEIVING ) {	// break has already been detected
 		if ( _next_read_slot > 1 ) {						// break before end of maximum frame
 			if ( _receivedData[0] == 0 ) {				// zero start code is DMX
@@ -371,46 +805,207 @@ void LXSAMD51DMX::breakReceived( void ) {
 	}
 	_dmx_read_state = DMX_READ_STATE_START;		        //break causes spurious 0 byte on next interrupt, ignore...
 	_next_read_slot = 0;
-	_packet_length = DMX_MAX_FRAME;						// default to receive complete frame
+	_packet_length = LXSAMD51DMX_RECEIVE_SIZE;			// default to receive complete frame
+#if LXSAMD51DMX_RDM
+	_rdm_read_checksum = 0;
+	_rdm_read_checksum_len = DMX_MAX_FRAME;
+#endif
 }
 
 void LXSAMD51DMX::byteReceived(uint8_t c) {
 
+	LX_PROFILE(LX_PROFILE_BYTE_RECEIVED);
 	if ( _dmx_read_state == DMX_READ_STATE_RECEIVING ) {
-	//digitalWrite(6, LOW);//<- debug pin
 		_receivedData[_next_read_slot] = c;
+#if LXSAMD51DMX_RDM
+		if ( _next_read_slot < _rdm_read_checksum_len ) {	//running RDM checksum, ignored for DMX
+			_rdm_read_checksum += c;
+		}
+#endif
 		if ( _next_read_slot == 2 ) {						//RDM length slot
-			if ( _receivedData[0] == RDM_START_CODE ) {			//RDM start code
+			if ( _receivedData[0] == 0 ) {
+				_packet_length = LXSAMD51DMX_MAX_FRAME;		//slots past LXSAMD51DMX_MAX_SLOTS are not kept
+#if LXSAMD51DMX_RDM
+			} else if ( _receivedData[0] == RDM_START_CODE ) {	//RDM start code
+				_rdm_read_checksum_len = c;				//checksum covers message length
 				if ( _rdm_read_handled == 0 ) {
 					_packet_length = c + 2;				//add two bytes for checksum
 				}
 			} else if ( _receivedData[0] == 0xFE ) {	//RDM Discovery Response
-				_packet_length = DMX_MAX_FRAME;
-			} else if ( _receivedData[0] != 0 ) {		// if Not Null Start Code
+				_packet_length = LXSAMD51DMX_RECEIVE_SIZE;
+#endif
+			} else {									// if Not Null Start Code
 				_dmx_read_state = DMX_STATE_IDLE;			//unrecognized, ignore packet
 			}
 		}
 	
 		_next_read_slot++;
+#if LXSAMD51DMX_RDM
+		if ( _rdm_read_handled ) {						// reading a response, turnaround starts after each byte
+			_rdm_rx_end_us = micros();
+			_rdm_rx_end_valid = 1;
+		}
+#endif
 		if ( _next_read_slot >= _packet_length ) {		//reached expected end of packet
 			packetComplete();
 		}
-		//digitalWrite(6, HIGH);//<- debug pin
 	} else if ( _dmx_read_state == DMX_READ_STATE_START ) {
 		_dmx_read_state = DMX_READ_STATE_RECEIVING;
 	}
 }
+#endif
 
+#if LXSAMD51DMX_RDM
+uint8_t LXSAMD51DMX::validateReceivedRDMPacket( void ) {
+	if ( _receivedData[0] != RDM_START_CODE ) {
+		return 0;
+	}
+	if ( ( _rdm_read_checksum_len < RDM_PKT_BASE_MSG_LEN ) || ( _next_read_slot < _rdm_read_checksum_len+2 ) ) {
+		return 0;								//malformed or incomplete
+	}
+	return testRDMChecksum(_rdm_read_checksum, _receivedData, _rdm_read_checksum_len);
+}
+#endif
+
+#if LXSAMD51DMX_INPUT
 void LXSAMD51DMX::setDataReceivedCallback(LXRecvCallback callback) {
 	_receive_callback = callback;
 }
 
+void LXSAMD51DMX::setCallbackMode( uint8_t mode ) {
+	_callback_mode = mode;
+	if ( _interrupt_mode != ISR_DISABLED ) {
+		setInterruptPriorities();
+	}
+}
+
+uint8_t LXSAMD51DMX::callbackMode( void ) {
+	return _callback_mode;
+}
+
+void LXSAMD51DMX::runDeferredCallbacks( void ) {
+	noInterrupts();								// SERCOM interrupt may record the next packet meanwhile
+	uint8_t events = _deferred_events;
+	_deferred_events = 0;
+	uint16_t slots = _deferred_slots;
+	uint16_t rdm_len = _deferred_rdm_len;
+	interrupts();
+	
+	if ( ( events & LX_DEFERRED_DMX ) && ( _receive_callback != NULL ) ) {
+		_receive_callback(slots);
+	}
+#if LXSAMD51DMX_RDM
+	if ( ( events & LX_DEFERRED_RDM ) && ( _rdm_receive_callback != NULL ) ) {
+		_rdm_receive_callback(rdm_len);
+	}
+#else
+	(void)rdm_len;
+#endif
+}
+
+void LXSAMD51DMX::deferCallback( uint8_t event, uint16_t len ) {
+	if ( event == LX_DEFERRED_DMX ) {
+		_deferred_slots = len;
+	} else {
+		_deferred_rdm_len = len;
+	}
+	_deferred_events |= event;
+	NVIC_SetPendingIRQ(LXSAMD51DMX_DEFER_IRQn);
+}
+
+void LXSAMD51DMX::setInterruptPriorities( void ) {
+	uint32_t lowest = ( 1 << __NVIC_PRIO_BITS ) - 1;		// core default for SERCOM
+	uint32_t sercom = ( _callback_mode == LX_CALLBACK_DEFERRED ) ? lowest - 1 : lowest;
+	for (int j=0; j<4; j++) {
+		NVIC_SetPriority((IRQn_Type)(DMX_SERCOM_IRQn + j), sercom);
+	}
+	if ( _callback_mode == LX_CALLBACK_DEFERRED ) {		// spare interrupt is only taken when used
+		NVIC_SetPriority(LXSAMD51DMX_DEFER_IRQn, lowest);
+		NVIC_EnableIRQ(LXSAMD51DMX_DEFER_IRQn);
+	} else {
+		NVIC_DisableIRQ(LXSAMD51DMX_DEFER_IRQn);
+	}
+}
+#endif
+
+/*********************************** FreeRTOS Methods *************************************/
+
+#if defined LXSAMD51DMX_FREERTOS
+#if LXSAMD51DMX_INPUT
+void LXSAMD51DMX::setNotifyTask( TaskHandle_t task ) {
+	_notify_task = task;
+}
+#endif
+
+#if LXSAMD51DMX_RDM
+void LXSAMD51DMX::lockBus( void ) {
+	if ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) {
+		return;									// single thread, nothing to guard
+	}
+	xSemaphoreTakeRecursive(_bus_mutex, portMAX_DELAY);
+	if ( _bus_lock_depth++ == 0 ) {
+		_bus_owner = xTaskGetCurrentTaskHandle();
+	}
+}
+
+void LXSAMD51DMX::unlockBus( void ) {
+	if ( ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) || ( _bus_lock_depth == 0 ) ) {
+		return;
+	}
+	if ( --_bus_lock_depth == 0 ) {
+		_bus_owner = NULL;
+	}
+	xSemaphoreGiveRecursive(_bus_mutex);
+}
+#endif
+
+uint8_t LXSAMD51DMX::waitForISR( void ) {
+	if ( ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) || ( _bus_owner != xTaskGetCurrentTaskHandle() ) ) {
+		return 0;								// caller polls
+	}
+	// the timeout covers a notification sent before the wait started, the caller tests its condition again
+	xTaskNotifyWait(0, LX_NOTIFY_BUS, NULL, pdMS_TO_TICKS(LX_RTOS_WAIT_MS));
+	return 1;
+}
+
+void LXSAMD51DMX::wakeBusOwner( void ) {
+	TaskHandle_t owner = _bus_owner;
+	if ( owner != NULL ) {
+		notifyTask(owner, LX_NOTIFY_BUS);
+	}
+}
+
+void LXSAMD51DMX::notifyTask( TaskHandle_t task, uint32_t bits ) {
+	if ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) {
+		return;
+	}
+	if ( __get_IPSR() ) {						// in an interrupt handler
+		BaseType_t woken = pdFALSE;
+		xTaskNotifyFromISR(task, bits, eSetBits, &woken);
+		portYIELD_FROM_ISR(woken);
+	} else {
+		xTaskNotify(task, bits, eSetBits);
+	}
+}
+
+void LXSAMD51DMX::sleepMS( uint32_t ms ) {
+	if ( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ) {
+		vTaskDelay(pdMS_TO_TICKS(ms));
+	} else {
+		delay(ms);
+	}
+}
+#endif
+
 /************************************ RDM Methods **************************************/
 
+#if LXSAMD51DMX_RDM
 void LXSAMD51DMX::setRDMReceivedCallback(LXRecvCallback callback) {
 	_rdm_receive_callback = callback;
 }
+#endif
 
+#if LXSAMD51DMX_OUTPUT
 void LXSAMD51DMX::outputIRQHandler(void) {
 	//clear frame error & ignore
 	if (DMX_sercom.isFrameErrorUART()) {
@@ -434,9 +1029,17 @@ void LXSAMD51DMX::outputIRQHandler(void) {
 		DMX_sercom.clearStatusUART();
 	}
 }
+#endif
 
+#if LXSAMD51DMX_INPUT
 void LXSAMD51DMX::inputIRQHandler(void) {
 
+#if LXSAMD51DMX_RDM
+		if ( ( _dmx_send_state == DMX_STATE_LISTEN ) && DMX_SERCOM->USART.INTFLAG.bit.DRE ) {
+			dataRegisterEmpty();						// filler slot timing response window
+		}
+#endif
+
 		if ( DMX_SERCOM->USART.INTFLAG.bit.ERROR ) {
 		   DMX_SERCOM->USART.INTFLAG.bit.ERROR = 1;		//acknowledge error, clear interrupt
 		   
@@ -446,6 +1049,7 @@ void LXSAMD51DMX::inputIRQHandler(void) {
 				DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_RXC;
 				return;
 			}
+			LX_TRACE(LX_TRACE_UART_ERROR, DMX_SERCOM->USART.STATUS.reg);
 			// other error flags?
 			//return;
 		}	//ERR
@@ -462,7 +1066,9 @@ void LXSAMD51DMX::inputIRQHandler(void) {
 	}
 	
 }		  // <-inputIRQHandler(void)
+#endif
 
+#if LXSAMD51DMX_RDM
 void LXSAMD51DMX::rdmIRQHandler(void) {
 	if ( _rdm_task_mode ) {
 		outputIRQHandler();
@@ -478,55 +1084,65 @@ uint8_t LXSAMD51DMX::rdmTaskMode( void ) {		// applies to bidirectional RDM conn
 }
 
 void LXSAMD51DMX::setTaskSendDMX( void ) {		// only valid if connection started using startRDM()
-	digitalWrite(_direction_pin, HIGH);
+	setDirection(HIGH);
 	 _rdm_task_mode = DMX_TASK_SEND;
 }
 
 
 void LXSAMD51DMX::restoreTaskSendDMX( void ) {		// only valid if connection started using startRDM()
-	digitalWrite(_direction_pin, HIGH);
+	LX_BUS_LOCK();
+	if ( _rdm_task_mode != DMX_TASK_RECEIVE ) {		// already resumed at end of response window
+		return;
+	}
+	setDirection(HIGH);
 	_dmx_send_state = DMX_STATE_BREAK;
 	_rdm_task_mode = DMX_TASK_SET_SEND;
 	 transmissionComplete();		// sends break and sets interrupt
-	 delay(1);
+	 LX_WAIT_FOR_ISR(delay(1));
 	 while ( _rdm_task_mode != DMX_TASK_SEND ) {
-	 	delay(1);
+	 	LX_WAIT_FOR_ISR(delay(1));
 	 }
 }
 
 void LXSAMD51DMX::setTaskReceive( void ) {		// only valid if connection started using startRDM()
 	_next_read_slot = 0;
-	_packet_length = DMX_MAX_FRAME;
+	_packet_length = LXSAMD51DMX_RECEIVE_SIZE;
     _dmx_send_state = DMX_STATE_IDLE;
     _rdm_task_mode = DMX_TASK_RECEIVE;
     _rdm_read_handled = 0;
+    DMX_SERCOM->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
     
-    
-    digitalWrite(_direction_pin, LOW);
+    setDirection(LOW);
 }
 
-void LXSAMD51DMX::sendRawRDMPacket( uint8_t len ) {		// only valid if connection started using startRDM()
-	_rdm_len = len;
-	// calculate checksum:  len should include 2 bytes for checksum at the end
-	uint16_t checksum = rdmChecksum(_rdmPacket, _rdm_len-2);
-	_rdmPacket[_rdm_len-2] = checksum >> 8;
-	_rdmPacket[_rdm_len-1] = checksum & 0xFF;
+void LXSAMD51DMX::sendRawRDMPacket( uint16_t len ) {		// only valid if connection started using startRDM()
+	LX_BUS_LOCK();
+	startRawRDMPacket(len);
+	
+	if ( _rdm_read_handled ) {
+		while ( ! _rdm_response_ready ) {	//wait for response window to end
+			LX_WAIT_FOR_ISR(delayMicroseconds(RDM_RESPONSE_POLL_US));
+		}
+	} else {
+		while ( _rdm_task_mode ) {	//wait for packet to be sent and listening to start
+			LX_WAIT_FOR_ISR(delay(2));	//_rdm_task_mode is set to 0 (receive) after RDM packet is completely sent
+		}
+	}
+}
 
+void LXSAMD51DMX::startRawRDMPacket( uint16_t len ) {
+	_rdm_len = len;
+	_rdm_response_ready = 0;
+	// len should include 2 bytes for checksum at the end
+	// checksum is calculated and filled in as the packet is sent
 	if ( _rdm_task_mode ) {						//already sending, flag to send RDM
+		_rdm_send_buffer = _rdmPacket;
+		_rdm_checksum_slot = _rdm_len-2;
 		_rdm_task_mode = DMX_TASK_SET_SEND_RDM;
 	} else {
-		_rdm_task_mode = DMX_TASK_SEND_RDM;
-		digitalWrite(_direction_pin, HIGH);
-		_dmx_send_state = DMX_STATE_BREAK;
-		//set the interrupts
-		DMX_SERCOM->USART.INTENSET.reg =  SERCOM_USART_INTENSET_TXC | SERCOM_USART_INTENSET_ERROR;
-		//call transmissionComplete() to send break...
-		transmissionComplete();
-	}
-	
-	while ( _rdm_task_mode ) {	//wait for packet to be sent and listening to start
-		delay(2);				//_rdm_task_mode is set to 0 (receive) after RDM packet is completely sent
+		startRDMTransmit(_rdmPacket, len, 1);	//waits for turnaround, then sends break
 	}
+
 }
 
 void  LXSAMD51DMX::setupRDMDevicePacket(uint8_t* pdata, uint8_t msglen, uint8_t rtype, uint8_t msgs, uint16_t subdevice) {
@@ -539,6 +1155,9 @@ void  LXSAMD51DMX::setupRDMDevicePacket(uint8_t* pdata, uint8_t msglen, uint8_t
   	
   	pdata[RDM_IDX_TRANSACTION_NUM]	= _transaction;		//set this on read
   	pdata[RDM_IDX_RESPONSE_TYPE]	= rtype;
+  	if ( _rdm_message_queue ) {
+  		msgs = _rdm_message_queue->count();
+  	}
   	pdata[RDM_IDX_MSG_COUNT]		= msgs;
   	pdata[RDM_IDX_SUB_DEV_MSB] 		= subdevice >> 8;
   	pdata[RDM_IDX_SUB_DEV_LSB] 		= subdevice & 0xFF;
@@ -570,6 +1189,7 @@ void  LXSAMD51DMX::setupRDMMessageDataBlock(uint8_t* pdata, uint8_t cmdclass, ui
 }
 
 uint8_t LXSAMD51DMX::sendRDMDiscoveryPacket(UID* lower, UID* upper, UID* single) {
+	LX_BUS_LOCK();
 	uint8_t rv = RDM_NO_DISCOVERY;
 	uint8_t j;
 	
@@ -582,7 +1202,6 @@ uint8_t LXSAMD51DMX::sendRDMDiscoveryPacket(UID* lower, UID* upper, UID* single)
 	
 	_rdm_read_handled = 1;
 	sendRawRDMPacket(RDM_DISC_UNIQUE_BRANCH_PKTL);
-	delay(2);
 
 	// any bytes read indicate response to discovery packet
 	// check if a single, complete, uncorrupted packet has been received
@@ -627,11 +1246,11 @@ uint8_t LXSAMD51DMX::sendRDMDiscoveryPacket(UID* lower, UID* upper, UID* single)
 		resetFrame();	// new 12-22-20
 	}
 
-	restoreTaskSendDMX();
 	return rv;
 }
 
 uint8_t LXSAMD51DMX::sendRDMDiscoveryMute(UID* target, uint8_t cmd) {
+	LX_BUS_LOCK();
 	uint8_t rv = 0;
 
 	//Build RDM packet
@@ -640,117 +1259,345 @@ uint8_t LXSAMD51DMX::sendRDMDiscoveryMute(UID* target, uint8_t cmd) {
 	UID::copyFromUID(*target, _rdmPacket, 3);
 	setupRDMMessageDataBlock(_rdmPacket, RDM_DISCOVERY_COMMAND, cmd, 0x00);
 	
-	_rdm_read_handled = 1;
-	sendRawRDMPacket(RDM_PKT_BASE_TOTAL_LEN);
-
-	delay(3);
-
-	if ( _next_read_slot >= (RDM_PKT_BASE_TOTAL_LEN+2) ) {				//expected pdl 2 or 8
-		if ( validateRDMPacket(_receivedData) ) {
-			if ( _receivedData[RDM_IDX_RESPONSE_TYPE] == RDM_RESPONSE_TYPE_ACK ) {
-				if ( _receivedData[RDM_IDX_CMD_CLASS] == RDM_DISC_COMMAND_RESPONSE ) {
-					if ( THIS_DEVICE_ID == UID(&_receivedData[RDM_IDX_DESTINATION_UID]) ) {
-						rv = 1;
-					}
-				}
+	if ( rdmExchange(target) ) {								//expected pdl 2 or 8
+		if ( _receivedData[RDM_IDX_RESPONSE_TYPE] == RDM_RESPONSE_TYPE_ACK ) {
+			if ( _receivedData[RDM_IDX_CMD_CLASS] == RDM_DISC_COMMAND_RESPONSE ) {
+				rv = 1;
 			}
 		}
-		
+	}
+	return rv;
+}
+
+uint8_t LXSAMD51DMX::sendRDMControllerPacket( void ) {
+	LX_BUS_LOCK();
+	uint8_t rv = rdmTransaction();
+#if ! LXSAMD51DMX_SHARED_RDM_BUFFER
+	if ( rv ) {
+		uint16_t plen = _receivedData[2] + 2;
+		for(int j=0; j<plen; j++) {
+			_rdmData[j] = _receivedData[j];
+		}
+	}
+#endif
+	return rv;
+}
+
+uint8_t LXSAMD51DMX::startRDMControllerPacket( uint8_t* bytes, uint16_t len ) {
+	if ( ( len < RDM_PKT_BASE_TOTAL_LEN ) || ( len > RDM_MAX_FRAME ) ) {
+		return 0;
+	}
+	if ( ( bytes[0] != RDM_START_CODE ) || ( bytes[1] != RDM_SUB_START_CODE )
+	     || ( bytes[2] < RDM_PKT_BASE_MSG_LEN ) || ( bytes[2]+2 > len ) ) {
+		return 0;
+	}
+#if defined LXSAMD51DMX_FREERTOS
+	lockBus();									// held until rdmControllerPacketResult() returns a result
+#endif
+	if ( _rdm_async_pending || _rdm_read_handled ) {
+#if defined LXSAMD51DMX_FREERTOS
+		unlockBus();
+#endif
+		return 0;								// a request is in progress
+	}
+#if defined LXSAMD51DMX_FREERTOS
+	_rdm_async_locked = 1;
+#endif
+	memcpy(_rdmPacket, bytes, len);
+	_rdm_async_pending = 1;
+	_rdm_read_handled = 1;
+	startRawRDMPacket(_rdmPacket[2]+2);
+	return 1;
+}
+
+uint8_t LXSAMD51DMX::rdmControllerPacketResult( void ) {
+	if ( _rdm_async_pending && ! _rdm_response_ready ) {
+		return RDM_RESULT_NONE;
+	}
+#if defined LXSAMD51DMX_FREERTOS
+	if ( _rdm_async_locked ) {
+		_rdm_async_locked = 0;
+		unlockBus();
+	}
+#endif
+	if ( ! _rdm_async_pending ) {
+		return RDM_RESULT_TIMEOUT;				// none started or abandoned by stop()
+	}
+	_rdm_async_pending = 0;
+	_rdm_received_len = ( _next_read_slot < RDM_MAX_FRAME ) ? _next_read_slot : RDM_MAX_FRAME;
+#if ! LXSAMD51DMX_SHARED_RDM_BUFFER
+	memcpy(_rdmData, _receivedData, _rdm_received_len);
+#endif
+	
+	if ( _rdm_received_len > 0 ) {
+		_rdm_result = validateReceivedRDMPacket() ? RDM_RESULT_ACK : RDM_RESULT_CHECKSUM;
 		_rdm_read_handled = 0;
 		resetFrame();
 	} else {
+		_rdm_result = RDM_RESULT_TIMEOUT;
 		_rdm_read_handled = 0;
 	}
-	restoreTaskSendDMX();
-	return rv;
+	return _rdm_result;
 }
 
-uint8_t LXSAMD51DMX::sendRDMControllerPacket( void ) {
+uint16_t LXSAMD51DMX::receivedRDMLength( void ) {
+	return _rdm_received_len;
+}
+
+uint8_t LXSAMD51DMX::rdmTransaction( void ) {
 	uint8_t rv = 0;
 	_rdm_read_handled = 1;
-	sendRawRDMPacket(_rdmPacket[2]+2);
-	delay(3);
+	sendRawRDMPacket(_rdmPacket[2]+2);			// returns when the response window has ended
 	
 	if ( _next_read_slot > 0 ) {
-		if ( validateRDMPacket(_receivedData) ) {
-			uint8_t plen = _receivedData[2] + 2;
-			for(int rv=0; rv<plen; rv++) {
-				_rdmData[rv] = _receivedData[rv];
-			}
-			rv = 1;
-		}
+		rv = validateReceivedRDMPacket();
+		_rdm_result = rv ? RDM_RESULT_ACK : RDM_RESULT_CHECKSUM;	// ACK until response type is checked
 		_rdm_read_handled = 0;
 		resetFrame();
 	} else {
+		_rdm_result = RDM_RESULT_TIMEOUT;
 		_rdm_read_handled = 0;
 	}
-	
-	restoreTaskSendDMX();
 	return rv;
 }
 
+uint8_t LXSAMD51DMX::rdmResponseMatches( UID* target ) {
+	if ( _receivedData[RDM_IDX_TRANSACTION_NUM] != _rdmPacket[RDM_IDX_TRANSACTION_NUM] ) {
+		return 0;											// late reply to an earlier request
+	}
+	if ( ! ( THIS_DEVICE_ID == &_receivedData[RDM_IDX_DESTINATION_UID] ) ) {
+		return 0;
+	}
+	return ( *target == &_receivedData[RDM_IDX_SOURCE_UID] );
+}
+
+uint8_t LXSAMD51DMX::rdmExchange( UID* target ) {
+	uint8_t* dest = target->rawbytes();
+	uint8_t broadcast = ( ( dest[2] & dest[3] & dest[4] & dest[5] ) == 0xFF );
+	uint16_t backoff = _rdm_backoff_ms;
+	
+	for (uint8_t attempt=0; ; attempt++) {
+		uint8_t rv = rdmTransaction();
+		if ( rv && ! rdmResponseMatches(target) ) {
+			_rdm_result = RDM_RESULT_INVALID;
+			rv = 0;
+		}
+		if ( broadcast ) {									// no response expected, nothing to count
+			return rv;
+		}
+		if ( _rdm_device_stats ) {
+			uint8_t result = _rdm_result;
+			if ( rv && ( _receivedData[RDM_IDX_RESPONSE_TYPE] == RDM_RESPONSE_TYPE_NACK_REASON ) ) {
+				result = RDM_RESULT_NACK;
+			}
+			_rdm_device_stats->record(target, result, lastRDMLatency());
+		}
+		if ( rv || ( attempt >= _rdm_retries ) ) {
+			return rv;
+		}
+		
+		if ( backoff ) {
+			LX_SLEEP_MS(backoff);
+			backoff <<= 1;
+		}
+		_rdmPacket[RDM_IDX_TRANSACTION_NUM] = _transaction++;	// checksum is filled in as the packet is sent
+	}
+}
+
+uint8_t LXSAMD51DMX::rdmResponseIncomplete( void ) {
+	if ( ( _next_read_slot > RDM_IDX_PACKET_SIZE ) && ( _receivedData[0] == RDM_START_CODE ) ) {
+		return ( _next_read_slot < _receivedData[RDM_IDX_PACKET_SIZE]+2 );
+	}
+	return 0;
+}
+
+uint8_t LXSAMD51DMX::completeRDMTransaction(UID* target, uint8_t cmdclass, uint16_t pid, uint16_t subdevice, uint8_t* info, uint16_t len, uint16_t* received) {
+	// _rdmPacket holds the first request
+	uint16_t total = 0;
+	uint8_t polls = 0;
+	uint8_t response_class = cmdclass + 1;
+	uint16_t request_pid = pid;
+	
+	while ( rdmExchange(target) ) {
+		uint8_t rtype = _receivedData[RDM_IDX_RESPONSE_TYPE];
+		uint16_t rpid = (_receivedData[RDM_IDX_PID_MSB] << 8) | _receivedData[RDM_IDX_PID_LSB];
+		uint8_t pdl = _receivedData[RDM_IDX_PARAM_DATA_LEN];
+		
+		if ( rtype == RDM_RESPONSE_TYPE_ACK_TIMER ) {
+			// response will be queued, wait estimated time (100ms units) then ask for it
+			if ( ( ++polls > RDM_ACK_TIMER_MAX_POLLS ) || ( pdl != 2 ) ) {
+				_rdm_result = ( pdl != 2 ) ? RDM_RESULT_INVALID : RDM_RESULT_TIMEOUT;
+				return 0;
+			}
+			LX_SLEEP_MS( ((_receivedData[24] << 8) | _receivedData[25]) * 100 );
+			request_pid = RDM_QUEUED_MESSAGE;
+		} else if ( ( rtype == RDM_RESPONSE_TYPE_ACK ) || ( rtype == RDM_RESPONSE_TYPE_ACK_OVERFLOW ) ) {
+			if ( ( rpid != pid ) || ( _receivedData[RDM_IDX_CMD_CLASS] != response_class ) ) {
+				// QUEUED_MESSAGE answered with a status or other message, not ready yet
+				if ( ++polls > RDM_ACK_TIMER_MAX_POLLS ) {
+					_rdm_result = RDM_RESULT_TIMEOUT;
+					return 0;
+				}
+				LX_SLEEP_MS(RDM_ACK_TIMER_POLL_MS);
+				request_pid = RDM_QUEUED_MESSAGE;
+			} else {
+				// copy straight from the receive buffer, truncating at len
+				if ( total < len ) {
+					uint16_t n = ( total + pdl > len ) ? ( len - total ) : pdl;
+					memcpy(&info[total], &_receivedData[24], n);
+				}
+				total += pdl;
+				if ( rtype == RDM_RESPONSE_TYPE_ACK ) {
+					if ( received ) {
+						*received = total;
+					}
+					if ( _rdm_cache && ( cmdclass == RDM_GET_COMMAND ) && ( total == pdl ) ) {
+						_rdm_cache->store(target, pid, subdevice, &_receivedData[24], pdl);
+					}
+					return 1;
+				}
+				if ( ( pdl == 0 ) || ( cmdclass != RDM_GET_COMMAND ) ) {	// overflow must make progress
+					_rdm_result = RDM_RESULT_INVALID;
+					return 0;
+				}
+			}
+		} else {
+			if ( rtype == RDM_RESPONSE_TYPE_NACK_REASON ) {
+				_rdm_result = RDM_RESULT_NACK;
+				_rdm_nack_reason = ( pdl == 2 ) ? ( (_receivedData[24] << 8) | _receivedData[25] ) : 0;
+			} else {
+				_rdm_result = RDM_RESULT_INVALID;
+			}
+			return 0;
+		}
+		
+		// next request: continue the overflow with the same PID or collect the queued response
+		if ( request_pid != RDM_QUEUED_MESSAGE ) {
+			setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN, RDM_PORT_ONE, subdevice);
+			UID::copyFromUID(*target, _rdmPacket, 3);
+			setupRDMMessageDataBlock(_rdmPacket, RDM_GET_COMMAND, pid, 0x00);
+		} else {										// QUEUED_MESSAGE is always for the root device
+			setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN, RDM_PORT_ONE, RDM_ROOT_DEVICE);
+			UID::copyFromUID(*target, _rdmPacket, 3);
+			_rdmPacket[RDM_IDX_PACKET_SIZE] = RDM_PKT_BASE_MSG_LEN+1;
+			setupRDMMessageDataBlock(_rdmPacket, RDM_GET_COMMAND, RDM_QUEUED_MESSAGE, 0x01);
+			_rdmPacket[24] = RDM_STATUS_ERROR;		// status messages other than errors are left queued
+		}
+	}
+	return 0;
+}
+
 uint8_t LXSAMD51DMX::sendRDMControllerPacket( uint8_t* bytes, uint8_t len ) {
+	LX_BUS_LOCK();
 	for (uint8_t j=0; j<len; j++) {
 		_rdmPacket[j] = bytes[j];
 	}
 	return sendRDMControllerPacket();
 }
 
-uint8_t LXSAMD51DMX::sendRDMGetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len) {
-	uint8_t rv = 0;
-	
+uint8_t LXSAMD51DMX::sendRDMGetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len, uint16_t subdevice) {
+	LX_BUS_LOCK();
+	if ( _rdm_cache && _rdm_cache->get(target, pid, subdevice, info, len, NULL) ) {
+		_rdm_result = RDM_RESULT_ACK;
+		return 1;
+	}
+	return refreshRDMGetCommand(target, pid, info, len, subdevice);
+}
+
+uint8_t LXSAMD51DMX::refreshRDMGetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len, uint16_t subdevice) {
+	LX_BUS_LOCK();
 	//Build RDM packet
 	// total packet length 0 parameter is 24 (+cksum =26 for sendRawRDMPacket) 
-	setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN, RDM_PORT_ONE, RDM_ROOT_DEVICE);
+	setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN, RDM_PORT_ONE, subdevice);
 	UID::copyFromUID(*target, _rdmPacket, 3);
 	setupRDMMessageDataBlock(_rdmPacket, RDM_GET_COMMAND, pid, 0x00);
 	
-	if ( sendRDMControllerPacket() ) {
-		if ( _rdmData[RDM_IDX_RESPONSE_TYPE] == RDM_RESPONSE_TYPE_ACK ) {
-			if ( _rdmData[RDM_IDX_CMD_CLASS] == RDM_GET_COMMAND_RESPONSE ) {
-				if ( THIS_DEVICE_ID == UID(&_rdmData[RDM_IDX_DESTINATION_UID]) ) {
-					rv = 1;
-					for(int j=0; j<len; j++) {
-						info[j] = _rdmData[24+j];
-					}
-				}
-			}
-		}
+	return completeRDMTransaction(target, RDM_GET_COMMAND, pid, subdevice, info, len, NULL);
+}
+
+uint8_t LXSAMD51DMX::sendRDMGetCommandLong(UID* target, uint16_t pid, uint8_t* info, uint16_t len, uint16_t* received, uint16_t subdevice) {
+	LX_BUS_LOCK();
+	if ( _rdm_cache && _rdm_cache->get(target, pid, subdevice, info, len, received) ) {
+		_rdm_result = RDM_RESULT_ACK;
+		return 1;
 	}
+	setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN, RDM_PORT_ONE, subdevice);
+	UID::copyFromUID(*target, _rdmPacket, 3);
+	setupRDMMessageDataBlock(_rdmPacket, RDM_GET_COMMAND, pid, 0x00);
 	
-	return rv;
+	return completeRDMTransaction(target, RDM_GET_COMMAND, pid, subdevice, info, len, received);
 }
 
-uint8_t LXSAMD51DMX::sendRDMSetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len) {
-	uint8_t rv = 0;
-	
+uint8_t LXSAMD51DMX::sendRDMSetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len, uint16_t subdevice) {
+	LX_BUS_LOCK();
+	if ( _rdm_cache ) {
+		_rdm_cache->invalidate(target, RDM_DEVICE_INFO);	// start address or personality may change
+	}
 	//Build RDM packet
 	// total packet length 1 byte parameter is 25 (+cksum =27 for sendRawRDMPacket) 
-	setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN+len, RDM_PORT_ONE, RDM_ROOT_DEVICE);
+	setupRDMControllerPacket(_rdmPacket, RDM_PKT_BASE_MSG_LEN+len, RDM_PORT_ONE, subdevice);
 	UID::copyFromUID(*target, _rdmPacket, 3);
 	setupRDMMessageDataBlock(_rdmPacket, RDM_SET_COMMAND, pid, len);
 	for(int j=0; j<len; j++) {
 		_rdmPacket[24+j] = info[j];
 	}
 	
-	if ( sendRDMControllerPacket() ) {
-		if ( _rdmData[RDM_IDX_RESPONSE_TYPE] == RDM_RESPONSE_TYPE_ACK ) {
-			if ( _rdmData[RDM_IDX_CMD_CLASS] == RDM_SET_COMMAND_RESPONSE ) {
-				if ( THIS_DEVICE_ID == UID(&_rdmData[RDM_IDX_DESTINATION_UID]) ) {
-					rv = 1;
-				}
-			}
+	return completeRDMTransaction(target, RDM_SET_COMMAND, pid, subdevice, NULL, 0, NULL);
+}
+
+uint16_t LXSAMD51DMX::sendRDMBatch(RDMBatchRequest* requests, uint16_t count, RDMBatchCallback callback, RDMBatchStats* stats) {
+	LX_BUS_LOCK();
+	uint32_t start_us = micros();
+	uint32_t start_transactions = _bus_stats.rdm_transactions;
+	uint16_t acked = 0;
+	
+	for (uint16_t j=0; j<count; j++) {
+		RDMBatchRequest* request = &requests[j];
+		uint16_t received = 0;
+		if ( request->cmdclass == RDM_SET_COMMAND ) {			// retried by rdmExchange
+			sendRDMSetCommand(&request->target, request->pid, request->data, request->len, request->subdevice);
+		} else {
+			sendRDMGetCommandLong(&request->target, request->pid, request->data, request->len, &received, request->subdevice);
+		}
+		request->result = _rdm_result;
+		request->pdl = received;
+		request->nack_reason = ( _rdm_result == RDM_RESULT_NACK ) ? _rdm_nack_reason : 0;
+		if ( _rdm_result == RDM_RESULT_ACK ) {
+			acked++;
+		}
+		if ( callback ) {
+			callback(request);
 		}
 	}
 	
-	return rv;
+	if ( stats ) {
+		stats->requests = count;
+		stats->acked = acked;
+		stats->transactions = _bus_stats.rdm_transactions - start_transactions;
+		stats->elapsed_us = micros() - start_us;
+		stats->per_second = stats->elapsed_us ? ( ( (uint64_t)stats->transactions * 1000000 ) / stats->elapsed_us ) : 0;
+	}
+	return acked;
+}
+
+uint8_t LXSAMD51DMX::lastRDMResult( void ) {
+	return _rdm_result;
+}
+
+uint16_t LXSAMD51DMX::lastRDMNackReason( void ) {
+	return _rdm_nack_reason;
+}
+
+uint16_t LXSAMD51DMX::receivedRDMSubdevice( void ) {
+	return (_rdmData[RDM_IDX_SUB_DEV_MSB] << 8) | _rdmData[RDM_IDX_SUB_DEV_LSB];
 }
 
 void LXSAMD51DMX::sendRDMGetResponse(UID target, uint16_t pid, uint8_t* info, uint8_t len) {
+	LX_BUS_LOCK();
 	uint8_t plen = RDM_PKT_BASE_MSG_LEN+len;
 	
 	//Build RDM packet
-	setupRDMDevicePacket(_rdmPacket, plen, RDM_RESPONSE_TYPE_ACK, 0, RDM_ROOT_DEVICE);
+	setupRDMDevicePacket(_rdmPacket, plen, RDM_RESPONSE_TYPE_ACK, 0, receivedRDMSubdevice());
 	UID::copyFromUID(target, _rdmPacket, 3);
 	setupRDMMessageDataBlock(_rdmPacket, RDM_GET_COMMAND_RESPONSE, pid, len);
 	for(int j=0; j<len; j++) {
@@ -761,10 +1608,11 @@ void LXSAMD51DMX::sendRDMGetResponse(UID target, uint16_t pid, uint8_t* info, ui
 }
 
 void LXSAMD51DMX::sendAckRDMResponse(uint8_t cmdclass, UID target, uint16_t pid) {
+	LX_BUS_LOCK();
 	uint8_t plen = RDM_PKT_BASE_MSG_LEN;
 	
 	//Build RDM packet
-	setupRDMDevicePacket(_rdmPacket, plen, RDM_RESPONSE_TYPE_ACK, 0, RDM_ROOT_DEVICE);
+	setupRDMDevicePacket(_rdmPacket, plen, RDM_RESPONSE_TYPE_ACK, 0, receivedRDMSubdevice());
 	UID::copyFromUID(target, _rdmPacket, 3);
 	setupRDMMessageDataBlock(_rdmPacket, cmdclass, pid, 0x00);
 	
@@ -772,10 +1620,11 @@ void LXSAMD51DMX::sendAckRDMResponse(uint8_t cmdclass, UID target, uint16_t pid)
 }
 
 void LXSAMD51DMX::sendMuteAckRDMResponse(uint8_t cmdclass, UID target, uint16_t pid) {
+	LX_BUS_LOCK();
 	uint8_t plen = RDM_PKT_BASE_MSG_LEN + 2;
 	
 	//Build RDM packet
-	setupRDMDevicePacket(_rdmPacket, plen, RDM_RESPONSE_TYPE_ACK, 0, RDM_ROOT_DEVICE);
+	setupRDMDevicePacket(_rdmPacket, plen, RDM_RESPONSE_TYPE_ACK, 0, receivedRDMSubdevice());
 	UID::copyFromUID(target, _rdmPacket, 3);
 	setupRDMMessageDataBlock(_rdmPacket, cmdclass, pid, 0x02);
 	
@@ -784,54 +1633,356 @@ void LXSAMD51DMX::sendMuteAckRDMResponse(uint8_t cmdclass, UID target, uint16_t
 
 
 void LXSAMD51DMX::sendRDMDiscoverBranchResponse( void ) {
+	LX_BUS_LOCK();
 	// should be listening when this is called
+	encodeRDMDiscoveryResponse();
+	startRDMTransmit(_disc_response, RDM_DISC_RESPONSE_FRAME, 0);
+	
+	while ( _rdm_task_mode ) {	//wait for packet to be sent and listening to start again
+		LX_WAIT_FOR_ISR(delay(1));	//_rdm_task_mode is set to 0 (receive) after RDM packet is completely sent
+	}
+}
+
+void LXSAMD51DMX::setAutoRDMDiscovery( uint8_t enable ) {
+	if ( enable ) {
+		encodeRDMDiscoveryResponse();
+	}
+	_rdm_auto_discovery = enable;
+}
+
+uint8_t LXSAMD51DMX::rdmDiscoveryMuted( void ) {
+	return _rdm_discovery_muted;
+}
+
+void LXSAMD51DMX::setRDMDiscoveryMuted( uint8_t muted ) {
+	_rdm_discovery_muted = muted;
+}
+
+void LXSAMD51DMX::setRDMMessageQueue( RDMMessageQueue* queue ) {
+	_rdm_message_queue = queue;
+}
+
+void LXSAMD51DMX::setRDMResponseCache( RDMResponseCache* cache ) {
+	_rdm_cache = cache;
+}
+
+RDMResponseCache* LXSAMD51DMX::rdmResponseCache( void ) {
+	return _rdm_cache;
+}
+
+void LXSAMD51DMX::setRDMDeviceStats( RDMDeviceStats* stats ) {
+	_rdm_device_stats = stats;
+}
+
+RDMDeviceStats* LXSAMD51DMX::rdmDeviceStats( void ) {
+	return _rdm_device_stats;
+}
+
+void LXSAMD51DMX::setRDMRetryPolicy( uint8_t retries, uint16_t backoff_ms ) {
+	_rdm_retries = retries;
+	_rdm_backoff_ms = backoff_ms;
+}
+
+uint16_t LXSAMD51DMX::lastRDMLatency( void ) {
+	return _rdm_reply_slots * 44;
+}
+
+void LXSAMD51DMX::setMinimumDMXRate( uint8_t hz ) {
+	if ( hz ) {
+		_dmx_min_period_us = 1000000ul / hz;
+	} else {
+		_dmx_min_period_us = 0;
+	}
+}
+
+void LXSAMD51DMX::setRDMTurnaround( uint16_t us ) {
+	if ( us < RDM_TURNAROUND_MIN_US ) {
+		_turnaround_us = RDM_TURNAROUND_MIN_US;
+	} else if ( us > RDM_TURNAROUND_MAX_US ) {
+		_turnaround_us = RDM_TURNAROUND_MAX_US;
+	} else {
+		_turnaround_us = us;
+	}
+}
+
+uint16_t LXSAMD51DMX::rdmTurnaround( void ) {
+	return _turnaround_us;
+}
+#endif
+
+void LXSAMD51DMX::getBusStats( LXDMXBusStats* stats ) {
+	noInterrupts();
+	*stats = _bus_stats;
+#if LXSAMD51DMX_RDM
+	stats->rdm_transaction_us = _rdm_cost_us;
+#endif
+	interrupts();
+	stats->elapsed_ms = millis() - _bus_stats_start_ms;
+	if ( stats->elapsed_ms ) {
+		stats->dmx_rate = ( (uint64_t)stats->dmx_frames * 1000 ) / stats->elapsed_ms;
+		stats->rdm_rate = ( (uint64_t)stats->rdm_transactions * 1000 ) / stats->elapsed_ms;
+	}
+}
+
+void LXSAMD51DMX::resetBusStats( void ) {
+	noInterrupts();
+	memset(&_bus_stats, 0, sizeof(LXDMXBusStats));
+	_bus_stats_start_ms = millis();
+	interrupts();
+}
+
+#if defined LXSAMD51DMX_PROFILE
+
+void LXSAMD51DMX::getProfile( LXISRProfile* profiles ) {
+	noInterrupts();
+	memcpy(profiles, _profile, sizeof(_profile));
+	interrupts();
+}
+
+void LXSAMD51DMX::resetProfile( void ) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;		// enable trace so DWT counts
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	noInterrupts();
+	memset(_profile, 0, sizeof(_profile));
+	for (uint8_t n=0; n<LX_PROFILE_COUNT; n++) {
+		_profile[n].min_cycles = 0xFFFFFFFF;
+	}
+	interrupts();
+}
+
+void LXSAMD51DMX::printProfile( Print& out ) {
+	const char* names[LX_PROFILE_COUNT] = { "isr", "tx_complete", "data_empty", "break_received", "byte_received", "packet_complete" };
+	LXISRProfile profiles[LX_PROFILE_COUNT];
+	getProfile(profiles);
+	out.println("handler count min max mean histogram(<64,<128...>=4096 cycles)");
+	for (uint8_t n=0; n<LX_PROFILE_COUNT; n++) {
+		LXISRProfile* p = &profiles[n];
+		out.print(names[n]);
+		out.print(' ');
+		out.print(p->count);
+		out.print(' ');
+		out.print(p->count ? p->min_cycles : 0);
+		out.print(' ');
+		out.print(p->max_cycles);
+		out.print(' ');
+		out.print(p->count ? (uint32_t)(p->total_cycles / p->count) : 0);
+		for (uint8_t b=0; b<LX_PROFILE_BUCKETS; b++) {
+			out.print(b ? ',' : ' ');
+			out.print(p->histogram[b]);
+		}
+		out.println();
+	}
+}
+
+void LXSAMD51DMX::recordProfile( uint8_t handler, uint32_t cycles ) {
+	LXISRProfile* p = &_profile[handler];
+	p->count++;
+	p->total_cycles += cycles;
+	if ( cycles < p->min_cycles ) {
+		p->min_cycles = cycles;
+	}
+	if ( cycles > p->max_cycles ) {
+		p->max_cycles = cycles;
+	}
+	int bucket = 0;
+	if ( cycles >> LX_PROFILE_BUCKET0_SHIFT ) {					// log2 with the CLZ instruction
+		bucket = ( 31 - __builtin_clz(cycles) ) - LX_PROFILE_BUCKET0_SHIFT + 1;
+		if ( bucket >= LX_PROFILE_BUCKETS ) {
+			bucket = LX_PROFILE_BUCKETS - 1;
+		}
+	}
+	p->histogram[bucket]++;
+}
+
+#endif
+
+#if defined LXSAMD51DMX_TRACE
+
+void LXSAMD51DMX::traceEvent( uint8_t event, uint16_t data ) {
+	uint16_t head = _trace_head;
+	if ( (uint16_t)(head - _trace_tail) >= LX_TRACE_DEPTH ) {
+		_trace_dropped++;
+		return;
+	}
+	LXTraceEvent* e = &_trace[head & (LX_TRACE_DEPTH-1)];
+	e->time_us = micros();
+	e->event = event;
+	e->state = ( _dmx_send_state << 4 ) | ( _rdm_task_mode & 0x0F );
+	e->data = data;
+	__asm__ __volatile__ ("" ::: "memory");			// event is complete before it is published
+	_trace_head = head + 1;
+}
+
+uint16_t LXSAMD51DMX::traceCount( void ) {
+	return (uint16_t)(_trace_head - _trace_tail);
+}
+
+uint8_t LXSAMD51DMX::readTraceEvent( LXTraceEvent* event ) {
+	uint16_t tail = _trace_tail;
+	if ( tail == _trace_head ) {
+		return 0;
+	}
+	*event = _trace[tail & (LX_TRACE_DEPTH-1)];
+	__asm__ __volatile__ ("" ::: "memory");			// copied before the slot is given back
+	_trace_tail = tail + 1;
+	return 1;
+}
+
+uint16_t LXSAMD51DMX::drainTrace( Print& out ) {
+	uint8_t block[4 + LX_TRACE_BLOCK_EVENTS*LX_TRACE_EVENT_SIZE];
+	uint16_t total = 0;
+	LXTraceEvent event;
 	
-	_rdmPacket[0] = 0;
-	_rdmPacket[1] = 0xFE;
-	_rdmPacket[2] = 0xFE;
-	_rdmPacket[3] = 0xFE;
-	_rdmPacket[4] = 0xFE;
-	_rdmPacket[5] = 0xFE;
-	_rdmPacket[6] = 0xFE;
-	_rdmPacket[7] = 0xFE;
-	_rdmPacket[8] = 0xAA;
-	
-	_rdmPacket[9] = THIS_DEVICE_ID.rawbytes()[0] | 0xAA;
-	_rdmPacket[10] = THIS_DEVICE_ID.rawbytes()[0] | 0x55;
-	_rdmPacket[11] = THIS_DEVICE_ID.rawbytes()[1] | 0xAA;
-	_rdmPacket[12] = THIS_DEVICE_ID.rawbytes()[1] | 0x55;
-	
-	_rdmPacket[13] = THIS_DEVICE_ID.rawbytes()[2] | 0xAA;
-	_rdmPacket[14] = THIS_DEVICE_ID.rawbytes()[2] | 0x55;
-	_rdmPacket[15] = THIS_DEVICE_ID.rawbytes()[3] | 0xAA;
-	_rdmPacket[16] = THIS_DEVICE_ID.rawbytes()[3] | 0x55;
-	_rdmPacket[17] = THIS_DEVICE_ID.rawbytes()[4] | 0xAA;
-	_rdmPacket[18] = THIS_DEVICE_ID.rawbytes()[4] | 0x55;
-	_rdmPacket[19] = THIS_DEVICE_ID.rawbytes()[5] | 0xAA;
-	_rdmPacket[20] = THIS_DEVICE_ID.rawbytes()[5] | 0x55;
-	
-	uint16_t checksum = rdmChecksum(&_rdmPacket[9], 12);
+	while ( traceCount() ) {
+		noInterrupts();
+		uint16_t dropped = _trace_dropped;
+		_trace_dropped = 0;
+		interrupts();
+		
+		uint8_t n = 0;
+		uint8_t* p = &block[4];
+		while ( ( n < LX_TRACE_BLOCK_EVENTS ) && readTraceEvent(&event) ) {
+			p[0] = event.time_us & 0xFF;
+			p[1] = ( event.time_us >> 8 ) & 0xFF;
+			p[2] = ( event.time_us >> 16 ) & 0xFF;
+			p[3] = event.time_us >> 24;
+			p[4] = event.event;
+			p[5] = event.state;
+			p[6] = event.data & 0xFF;
+			p[7] = event.data >> 8;
+			p += LX_TRACE_EVENT_SIZE;
+			n++;
+		}
+		block[0] = LX_TRACE_BLOCK_START;
+		block[1] = n;
+		block[2] = dropped & 0xFF;
+		block[3] = dropped >> 8;
+		out.write(block, 4 + n*LX_TRACE_EVENT_SIZE);
+		total += n;
+	}
+	return total;
+}
+
+void LXSAMD51DMX::resetTrace( void ) {
+	noInterrupts();
+	_trace_tail = _trace_head;
+	_trace_dropped = 0;
+	interrupts();
+}
+
+#endif
+
+#if LXSAMD51DMX_RDM
+void LXSAMD51DMX::encodeRDMDiscoveryResponse( void ) {
+	uint8_t* uid = THIS_DEVICE_ID.rawbytes();
+	
+	_disc_response[0] = 0;						// not sent
+	for(int j=1; j<8; j++) {
+		_disc_response[j] = 0xFE;				// preamble
+	}
+	_disc_response[8] = RDM_DISC_PREAMBLE_SEPARATOR;
+	
+	for(int j=0; j<6; j++) {
+		_disc_response[9+2*j] = uid[j] | 0xAA;
+		_disc_response[10+2*j] = uid[j] | 0x55;
+	}
+	
+	uint16_t checksum = rdmChecksum(&_disc_response[9], 12);
 	uint8_t bite = checksum >> 8;
-	_rdmPacket[21] = bite | 0xAA;
-	_rdmPacket[22] = bite | 0x55;
+	_disc_response[21] = bite | 0xAA;
+	_disc_response[22] = bite | 0x55;
 	bite = checksum & 0xFF;
-	_rdmPacket[23] = bite | 0xAA;
-	_rdmPacket[24] = bite | 0x55;
+	_disc_response[23] = bite | 0xAA;
+	_disc_response[24] = bite | 0x55;
+}
+
+uint8_t LXSAMD51DMX::autoRDMDiscovery( void ) {		// called from ISR with validated packet in _receivedData
+	if ( _receivedData[RDM_IDX_CMD_CLASS] != RDM_DISCOVERY_COMMAND ) {
+		return 0;
+	}
+	uint16_t pid = (_receivedData[RDM_IDX_PID_MSB] << 8) | _receivedData[RDM_IDX_PID_LSB];
+	uint8_t* uid = THIS_DEVICE_ID.rawbytes();
 	
-	// send (no break)
-	_rdm_len = 25;
-	digitalWrite(_direction_pin, HIGH); 	// could cut off receiving (?)
-	delayMicroseconds(100);
-	_next_send_slot = 1;//SKIP start code
-	setBaudRate(DMX_DATA_BAUD);
-	_dmx_send_state = DMX_STATE_DATA;
+	if ( pid == RDM_DISC_UNIQUE_BRANCH ) {
+		if ( ( _rdm_discovery_muted == 0 ) && ( _receivedData[RDM_IDX_PARAM_DATA_LEN] == RDM_DISC_UNIQUE_BRANCH_PDL ) ) {
+			// UIDs are big endian so memcmp orders them
+			if ( ( memcmp(&_receivedData[24], uid, 6) <= 0 ) && ( memcmp(uid, &_receivedData[30], 6) <= 0 ) ) {
+				startRDMTransmit(_disc_response, RDM_DISC_RESPONSE_FRAME, 0);
+			}
+		}
+		return 1;
+	}
 	
-	_rdm_task_mode = DMX_TASK_SEND_RDM;
-	 //set the interrupt
-    DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
+	if ( ( pid == RDM_DISC_MUTE ) || ( pid == RDM_DISC_UNMUTE ) ) {
+		uint8_t* dest = &_receivedData[RDM_IDX_DESTINATION_UID];
+		uint8_t unicast = ( memcmp(dest, uid, 6) == 0 );
+		if ( ! unicast ) {
+			// broadcast to all devices or to all devices with this manufacturer ID
+			if ( ( dest[2] & dest[3] & dest[4] & dest[5] ) != 0xFF ) {
+				return 1;
+			}
+			if ( ( ( dest[0] & dest[1] ) != 0xFF ) && ( ( dest[0] != uid[0] ) || ( dest[1] != uid[1] ) ) ) {
+				return 1;
+			}
+		}
+		_rdm_discovery_muted = ( pid == RDM_DISC_MUTE );
+		
+		if ( unicast ) {
+			uint16_t subdevice = (_receivedData[RDM_IDX_SUB_DEV_MSB] << 8) | _receivedData[RDM_IDX_SUB_DEV_LSB];
+			setupRDMDevicePacket(_rdm_auto_packet, RDM_PKT_BASE_MSG_LEN+2, RDM_RESPONSE_TYPE_ACK, 0, subdevice);
+			memcpy(&_rdm_auto_packet[RDM_IDX_DESTINATION_UID], &_receivedData[RDM_IDX_SOURCE_UID], 6);
+			_rdm_auto_packet[RDM_IDX_TRANSACTION_NUM] = _receivedData[RDM_IDX_TRANSACTION_NUM];
+			setupRDMMessageDataBlock(_rdm_auto_packet, RDM_DISC_COMMAND_RESPONSE, pid, 2);
+			_rdm_auto_packet[24] = 0;					// control field
+			_rdm_auto_packet[25] = 0;
+			startRDMTransmit(_rdm_auto_packet, RDM_MUTE_RESPONSE_LEN, 1);
+		}
+		return 1;
+	}
+	return 0;
+}
 
-	
-	while ( _rdm_task_mode ) {	//wait for packet to be sent and listening to start again
-		delay(1);				//_rdm_task_mode is set to 0 (receive) after RDM packet is completely sent
+void LXSAMD51DMX::startRDMTransmit( uint8_t* packet, uint16_t len, uint8_t with_break ) {
+	_rdm_send_buffer = packet;
+	_rdm_len = len;
+	_rdm_send_break = with_break;
+	if ( with_break ) {
+		_rdm_checksum_slot = len-2;				// checksum is filled in as the packet is sent
+	} else {
+		_rdm_checksum_slot = 0;					// encoded checksum is already in the packet
+		_next_send_slot = 1;					// SKIP start code
 	}
+	_guard_slots = turnaroundSlots();
+	_dmx_send_state = DMX_STATE_GUARD;
+	_rdm_task_mode = DMX_TASK_SEND_RDM;			// interrupts now go to outputIRQHandler
+	DMX_SERCOM->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
 }
+
+uint8_t LXSAMD51DMX::turnaroundSlots( void ) {
+	uint32_t remaining = _turnaround_us;
+	if ( _rdm_rx_end_valid ) {						// count from the end of the received packet
+		uint32_t elapsed = micros() - _rdm_rx_end_us;
+		remaining = ( elapsed < remaining ) ? remaining - elapsed : 0;
+	}
+	uint32_t slots = ( remaining + 43 ) / 44;
+	return ( slots > 0 ) ? slots : 1;				// one slot so the guard ends with TXC
+}
+
+void LXSAMD51DMX::takeLine( void ) {
+	setDirection(HIGH);
+	LX_TRACE(LX_TRACE_DIRECTION, HIGH);
+	if ( _rdm_rx_end_valid ) {
+		_rdm_rx_end_valid = 0;
+		uint32_t turnaround = micros() - _rdm_rx_end_us;
+		if ( turnaround > 0xFFFF ) {
+			turnaround = 0xFFFF;
+		}
+		if ( ( _bus_stats.min_turnaround_us == 0 ) || ( turnaround < _bus_stats.min_turnaround_us ) ) {
+			_bus_stats.min_turnaround_us = turnaround;
+		}
+		if ( turnaround > _bus_stats.max_turnaround_us ) {
+			_bus_stats.max_turnaround_us = turnaround;
+		}
+	}
+}
+#endif
@@ -64,6 +64,54 @@ TX (D0) |----------------------| 4 DI   Gnd 5 |---+------------ Pin 1
 #define DMX_MAX_SLOTS 512
 #define DMX_MAX_FRAME 513
 
+//***** compile time configuration, define these before the library is compiled (edit here or add them to the
+//      compiler flags) to leave out what a sketch does not use.  An output only build of 24 slots without RDM
+//      has 75 bytes of frame buffers instead of about 2.6K and no RDM code.
+
+//      largest frame sent or kept, longer frames received are truncated
+#ifndef LXSAMD51DMX_MAX_SLOTS
+#define LXSAMD51DMX_MAX_SLOTS	DMX_MAX_SLOTS
+#endif
+//      1 includes startOutput(), 0 for input only
+#ifndef LXSAMD51DMX_OUTPUT
+#define LXSAMD51DMX_OUTPUT		1
+#endif
+//      1 includes startInput(), 0 for output only
+#ifndef LXSAMD51DMX_INPUT
+#define LXSAMD51DMX_INPUT		1
+#endif
+//      1 includes startRDM() and the RDM methods, needs input and output
+#ifndef LXSAMD51DMX_RDM
+#define LXSAMD51DMX_RDM			( LXSAMD51DMX_OUTPUT && LXSAMD51DMX_INPUT )
+#endif
+//      1 leaves a received RDM packet in the receive buffer instead of copying it (saves 257 bytes),
+//      receivedRDMData() is then valid only until the next packet starts
+#ifndef LXSAMD51DMX_SHARED_RDM_BUFFER
+#define LXSAMD51DMX_SHARED_RDM_BUFFER	0
+#endif
+
+#if ( LXSAMD51DMX_MAX_SLOTS < DMX_MIN_SLOTS ) || ( LXSAMD51DMX_MAX_SLOTS > DMX_MAX_SLOTS )
+#error LXSAMD51DMX_MAX_SLOTS must be from DMX_MIN_SLOTS to DMX_MAX_SLOTS
+#endif
+#if ! ( LXSAMD51DMX_OUTPUT || LXSAMD51DMX_INPUT )
+#error LXSAMD51DMX_OUTPUT or LXSAMD51DMX_INPUT is required
+#endif
+#if LXSAMD51DMX_RDM && ! ( LXSAMD51DMX_OUTPUT && LXSAMD51DMX_INPUT )
+#error LXSAMD51DMX_RDM requires LXSAMD51DMX_OUTPUT and LXSAMD51DMX_INPUT
+#endif
+
+#define LXSAMD51DMX_MAX_FRAME	(LXSAMD51DMX_MAX_SLOTS+1)
+#if LXSAMD51DMX_OUTPUT
+#define LXSAMD51DMX_DMX_BUFFERS	3		// sending, committed and back buffer
+#else
+#define LXSAMD51DMX_DMX_BUFFERS	1		// last frame received
+#endif
+#if LXSAMD51DMX_RDM && ( LXSAMD51DMX_MAX_FRAME < RDM_MAX_FRAME )
+#define LXSAMD51DMX_RECEIVE_SIZE	RDM_MAX_FRAME
+#else
+#define LXSAMD51DMX_RECEIVE_SIZE	LXSAMD51DMX_MAX_FRAME
+#endif
+
 #define DIRECTION_PIN_NOT_USED 255
 
 //***** baud rate defines
@@ -77,6 +125,9 @@ TX (D0) |----------------------| 4 DI   Gnd 5 |---+------------ Pin 1
 #define DMX_STATE_START 1
 #define DMX_STATE_DATA  2
 #define DMX_STATE_IDLE  3
+#define DMX_STATE_GUARD 4
+#define DMX_STATE_LISTEN 5
+#define DMX_STATE_HOLD  6
 
 //***** status is if interrupts are enabled and IO is active
 #define ISR_DISABLED 		0
@@ -99,11 +150,202 @@ TX (D0) |----------------------| 4 DI   Gnd 5 |---+------------ Pin 1
 #define RDM_PARTIAL_DISCOVERY	1
 #define RDM_DID_DISCOVER		2
 
+//***** outcome of a controller GET or SET, see lastRDMResult()
+#define RDM_RESULT_NONE			0
+#define RDM_RESULT_ACK			1
+#define RDM_RESULT_NACK			2
+#define RDM_RESULT_TIMEOUT		3		// no response, or a queued response that never arrived
+#define RDM_RESULT_INVALID		4		// wrong transaction number or UID, or unexpected response
+#define RDM_RESULT_CHECKSUM		5		// corrupted or incomplete response
+
 #define RDM_DIRECTION_INPUT		0
 #define RDM_DIRECTION_OUTPUT	1
 
+//***** E1.20 turnaround, the line is left undriven at least this long after the end of a received packet
+//      timed with 44us slots clocked out with the driver disabled, see setRDMTurnaround()
+#define RDM_TURNAROUND_MIN_US		176
+//      a responder must start its response within 2ms
+#define RDM_TURNAROUND_MAX_US		2000
+
+//***** ACK_TIMER, maximum number of times QUEUED_MESSAGE is asked for a deferred response
+#define RDM_ACK_TIMER_MAX_POLLS		10
+#define RDM_ACK_TIMER_POLL_MS		100
+
+//***** bus scheduler, while RDM has the line filler slots are clocked out with the driver off to mark time
+//      a response must start within 2.8ms plus break (70 x 44us)
+#define RDM_RESPONSE_START_SLOTS	70
+//      and finish, 257 slots, by ~15ms
+#define RDM_RESPONSE_MAX_SLOTS		340
+//      line is held ~1ms for the next transaction if there is room before DMX is due
+#define RDM_GAP_MAX_SLOTS			23
+//      assumed length of a transaction until one has been measured
+#define RDM_TRANSACTION_INITIAL_US	5000
+//      RDM is sent anyway after this many DMX frames without room
+#define RDM_MAX_DEFERRED_FRAMES		8
+
+//***** controller requests that get no valid response are sent again, see setRDMRetryPolicy()
+#define RDM_DEFAULT_RETRIES			2
+//      wait before the first retry, doubled for each one after
+#define RDM_DEFAULT_BACKOFF_MS		0
+//      polling interval while waiting for the response window to end
+#define RDM_RESPONSE_POLL_US		44
+
+//***** copyReceivedSlots() gives up after this many copies spoiled by a new frame
+#define DMX_SNAPSHOT_RETRIES		4
+
+//***** received callbacks are called from the SERCOM interrupt or later from a spare one, see setCallbackMode()
+#define LX_CALLBACK_DIRECT			0
+#define LX_CALLBACK_DEFERRED		1
+//      the spare interrupt runs at the lowest priority, its peripheral (by default the frequency meter) can't be used
+//      define both to use another spare interrupt
+#if ! defined LXSAMD51DMX_DEFER_IRQn && ! defined LXSAMD51DMX_DEFER_HANDLER
+#define LXSAMD51DMX_DEFER_IRQn		FREQM_IRQn
+#define LXSAMD51DMX_DEFER_HANDLER	FREQM_Handler
+#elif ! defined LXSAMD51DMX_DEFER_IRQn || ! defined LXSAMD51DMX_DEFER_HANDLER
+#error "LXSAMD51DMX_DEFER_IRQn and LXSAMD51DMX_DEFER_HANDLER must be defined together"
+#endif
+//      packets waiting for their callback
+#define LX_DEFERRED_DMX				0x01
+#define LX_DEFERRED_RDM				0x02
+
+//***** encoded discovery response, slot 0 is not sent
+#define RDM_DISC_RESPONSE_FRAME		25
+//***** DISC_MUTE response, 24 byte header + 2 byte control field + checksum
+#define RDM_MUTE_RESPONSE_LEN		28
+
 typedef void (*LXRecvCallback)(int);
 
+/*!
+ * @brief line usage reported by LXSAMD51DMX::getBusStats()
+ */
+typedef struct {
+	uint32_t dmx_frames;			// DMX frames started
+	uint32_t rdm_transactions;		// controller requests sent
+	uint32_t rdm_deferred;			// DMX frames sent while a request waited to keep the minimum rate
+	uint32_t max_dmx_interval_us;	// longest break to break time between DMX frames
+	uint32_t rdm_transaction_us;	// estimated line time of a transaction
+	uint32_t elapsed_ms;			// since resetBusStats()
+	uint16_t dmx_rate;				// DMX frames per second over elapsed_ms
+	uint16_t rdm_rate;				// RDM transactions per second over elapsed_ms
+	uint16_t min_turnaround_us;		// end of a received RDM packet to line driver enabled, 0 if none measured
+	uint16_t max_turnaround_us;
+} LXDMXBusStats;
+
+//***** uncomment (or define when compiling) to time the interrupt handlers with the DWT cycle counter
+//#define LXSAMD51DMX_PROFILE
+
+//***** handlers timed when LXSAMD51DMX_PROFILE is defined, index into getProfile()
+#define LX_PROFILE_ISR				0	// whole interrupt, includes the handlers below
+#define LX_PROFILE_TX_COMPLETE		1	// transmissionComplete(), break/mark/guard/idle transitions
+#define LX_PROFILE_DATA_EMPTY		2	// dataRegisterEmpty(), next slot
+#define LX_PROFILE_BREAK_RECEIVED	3	// breakReceived()
+#define LX_PROFILE_BYTE_RECEIVED	4	// byteReceived()
+#define LX_PROFILE_PACKET_COMPLETE	5	// packetComplete(), includes received callbacks
+#define LX_PROFILE_COUNT			6
+
+//***** histogram bucket 0 counts calls under 64 cycles, each bucket after doubles, the last counts 4096 or more
+#define LX_PROFILE_BUCKETS			8
+#define LX_PROFILE_BUCKET0_SHIFT	6
+
+/*!
+ * @brief CPU cycles spent in one interrupt handler, reported by LXSAMD51DMX::getProfile()
+ */
+typedef struct {
+	uint32_t count;
+	uint32_t min_cycles;
+	uint32_t max_cycles;
+	uint64_t total_cycles;			// mean is total_cycles / count
+	uint32_t histogram[LX_PROFILE_BUCKETS];
+} LXISRProfile;
+
+//***** uncomment (or define when compiling) to record interrupt handler events in a ring, see drainTrace()
+//#define LXSAMD51DMX_TRACE
+
+//***** events in LXTraceEvent, data depends on the event
+#define LX_TRACE_BREAK_SENT			1	// DMX frame started, data is slots
+#define LX_TRACE_BREAK_RECEIVED		2	// data is slots read since the previous break
+#define LX_TRACE_DIRECTION			3	// direction pin changed from the interrupt handler, data is HIGH or LOW
+#define LX_TRACE_STATE				4	// send state changed, data is the new DMX_STATE_
+#define LX_TRACE_RDM_START			5	// RDM packet started, data is length, bit 15 set if sent without break
+#define LX_TRACE_RESPONSE_START		6	// first byte of a response, data is filler slots waited
+#define LX_TRACE_RESPONSE_END		7	// response window closed, data is bytes received
+#define LX_TRACE_TIMEOUT			8	// response window closed with nothing received, data is filler slots waited
+#define LX_TRACE_DMX_RECEIVED		9	// data is slots
+#define LX_TRACE_RDM_RECEIVED		10	// valid RDM packet, data is length
+#define LX_TRACE_CHECKSUM_ERROR		11	// data is bytes received
+#define LX_TRACE_UNKNOWN_PACKET		12	// data is start code
+#define LX_TRACE_UART_ERROR			13	// data is SERCOM USART STATUS
+
+//***** number of events held until drained, must be a power of two
+#define LX_TRACE_DEPTH				64
+//***** events written by each block of drainTrace()
+#define LX_TRACE_BLOCK_EVENTS		32
+#define LX_TRACE_BLOCK_START		0x54	// 'T'
+#define LX_TRACE_EVENT_SIZE			8
+
+//***** uncomment (or define when compiling) for sketches using the Seeed FreeRTOS port
+//      RDM requests block their task until the interrupt handler signals it instead of polling,
+//      requests from several tasks take turns and received packets can be signalled to a task
+//#define LXSAMD51DMX_FREERTOS
+
+#if defined LXSAMD51DMX_FREERTOS
+#include <Seeed_Arduino_FreeRTOS.h>
+
+//***** bits set in the notification value of the task passed to setNotifyTask()
+#define LX_NOTIFY_DMX				0x01	// DMX frame received
+#define LX_NOTIFY_RDM				0x02	// RDM packet received
+//      set for the task waiting on the bus during an RDM request, cleared when it wakes
+#define LX_NOTIFY_BUS				0x80000000
+//      longest a waiting task sleeps before checking the bus again, only matters if a wake up is missed
+#define LX_RTOS_WAIT_MS				50
+#endif
+
+/*!
+ * @brief an event recorded by the interrupt handler when LXSAMD51DMX_TRACE is defined
+ * @discussion state is the send state in the high nibble, the RDM task mode in the low nibble
+ */
+typedef struct {
+	uint32_t time_us;				// micros() when recorded
+	uint8_t  event;
+	uint8_t  state;
+	uint16_t data;
+} LXTraceEvent;
+
+/*!
+ * @brief a GET or SET sent by LXSAMD51DMX::sendRDMBatch
+ * @discussion For GET, data receives up to len bytes of the response and pdl is set to its length.
+ *             For SET, data holds len bytes of parameter data.
+ *             result is one of RDM_RESULT_*, nack_reason is set if result is RDM_RESULT_NACK.
+ */
+typedef struct {
+	UID      target;
+	uint16_t pid;
+	uint16_t subdevice;
+	uint8_t  cmdclass;				// RDM_GET_COMMAND or RDM_SET_COMMAND
+	uint8_t* data;
+	uint8_t  len;
+	uint16_t pdl;
+	uint8_t  result;
+	uint16_t nack_reason;
+} RDMBatchRequest;
+
+typedef void (*RDMBatchCallback)(RDMBatchRequest* request);
+
+/*!
+ * @brief throughput of a batch reported by LXSAMD51DMX::sendRDMBatch
+ */
+typedef struct {
+	uint16_t requests;
+	uint16_t acked;
+	uint32_t transactions;			// packets sent, including retries, overflow and queued message requests
+	uint32_t elapsed_us;
+	uint16_t per_second;			// transactions per second
+} RDMBatchStats;
+
+class RDMMessageQueue;
+class RDMResponseCache;
+class RDMDeviceStats;
+
 /*!   
 @class LXSAMD51DMX
 @abstract
@@ -131,7 +373,9 @@ class LXSAMD51DMX  {
     *             sets globals accessed in ISR, 
     *             enables transmission (TE) and tx interrupts (TIE/TCIE).
    */
+#if LXSAMD51DMX_OUTPUT
    void startOutput( void );
+#endif
    
    /*!
     * @brief starts interrupt that continuously reads DMX data
@@ -139,14 +383,17 @@ class LXSAMD51DMX  {
     *             sets globals accessed in ISR, 
     *             enables receive (RE) and rx interrupt (RIE)
    */
+#if LXSAMD51DMX_INPUT
    void startInput( void );
+#endif
    
    /*!
     * @brief starts interrupt that continuously sends DMX output
     * @discussion  direction pin is required, calls startOutput
    */
-   
+#if LXSAMD51DMX_RDM
    void startRDM( uint8_t pin, uint8_t direction=1);
+#endif
    
    /*!
     * @brief disables tx, rx and interrupts.
@@ -162,7 +409,7 @@ class LXSAMD51DMX  {
 	
 	/*!
 	 * @brief Sets the number of slots (aka addresses or channels) sent per DMX frame.
-	 * @discussion defaults to 512 or DMX_MAX_SLOTS and should be no less DMX_MIN_SLOTS slots.  
+	 * @discussion defaults to LXSAMD51DMX_MAX_SLOTS and should be no less DMX_MIN_SLOTS slots.  
 	 *             The DMX standard specifies min break to break time no less than 1024 usecs.  
 	 *             At 44 usecs per slot ~= 24
 	 * @param slot the highest slot number (~24 to 512)
@@ -174,6 +421,7 @@ class LXSAMD51DMX  {
     * @discussion NOTE: Data is not double buffered.  
     *                   So a complete single frame is not guaranteed.  
     *                   The ISR continuously reads the next frame into the buffer
+    *                   Use copyReceivedSlots() when values must come from the same frame.
     * @return level (0-255)
    */
    uint8_t getSlot (int slot);
@@ -183,20 +431,64 @@ class LXSAMD51DMX  {
 	 * @param slot number of the slot/address/channel (1-512)
 	 * @param value level (0-255)
 	*/
+#if LXSAMD51DMX_OUTPUT
    void setSlot (int slot, uint8_t value);
+#endif
    
    /*!
     * @brief provides direct access to data array
     * @return pointer to dmx array
    */
    uint8_t* dmxData(void);
-      
+   
+   /*!
+    * @brief buffer for filling the next output frame while the current one is sent
+    * @discussion Fill the start code and slots, then call commitDMXBackBuffer.
+    *             The buffer is not used by the ISR and may be left unfinished.
+    * @return pointer to dmx array including start code, changes after each commit
+   */
+#if LXSAMD51DMX_OUTPUT
+   uint8_t* dmxBackBuffer(void);
+   
+   /*!
+    * @brief sends the back buffer, starting with the next break
+    * @discussion The frame replaces the current one at the break so a frame is never sent partly updated.
+    *             If another frame is committed first, only the later one is sent.
+    *             Once sending starts, dmxData() is the committed frame and setSlot() changes it.
+    * @param slots number of slots in the frame, 0 keeps the current number
+   */
+   void commitDMXBackBuffer(uint16_t slots=0);
+#endif
+
+#if LXSAMD51DMX_RDM
 	uint8_t* rdmData( void );
+	uint8_t* receivedRDMData( void );
+#endif
 
+#if LXSAMD51DMX_INPUT
 	uint8_t* receivedData( void );
-
-	uint8_t* receivedRDMData( void );
 	
+	/*!
+    * @brief number of DMX frames received, advanced by the ISR as each frame is copied to dmxData()
+   */
+	uint32_t frameSequence( void );
+	
+	/*!
+    * @brief 1 if a frame has been received since frameSequence() returned sequence
+   */
+	uint8_t  newFrameSince( uint32_t sequence );
+	
+	/*!
+    * @brief copies slots of the last received frame, all from the same frame
+    * @discussion Interrupts are not disabled.  If a frame arrives during the copy, the copy is repeated,
+    *             up to DMX_SNAPSHOT_RETRIES times.  Slot 0 is the start code.
+    * @param sequence (optional, may be NULL) set to the frameSequence() of the frame copied
+    * @return 1 if the slots were copied, 0 if the range is outside the frame or frames kept arriving
+   */
+	uint8_t  copyReceivedSlots( uint8_t* dest, uint16_t start, uint16_t count, uint32_t* sequence=NULL );
+#endif
+	
+#if LXSAMD51DMX_OUTPUT
 	/*!
     * @brief called when last data byte and break are completely sent
    */
@@ -206,7 +498,17 @@ class LXSAMD51DMX  {
     * @brief called when data register is empty and ready for the next byte
    */
 	void dataRegisterEmpty( void );
+#endif
+	
+#if LXSAMD51DMX_RDM
+	/*!
+    * @brief next byte of _rdmPacket to send
+    * @discussion adds the byte to the running checksum and fills in the checksum when it is reached
+   */
+	uint8_t nextRDMSlot( void );
+#endif
    
+#if LXSAMD51DMX_INPUT
    /*!
     * @brief utility for debugging prints received data
    */
@@ -229,9 +531,28 @@ class LXSAMD51DMX  {
   	
   	/*!
     * @brief called from isr when a byte is read from register
+    * @discussion keeps a running checksum of RDM packets as bytes arrive
    */
   	void byteReceived(uint8_t c);
+#endif
+  	
+#if LXSAMD51DMX_RDM
+  	/*!
+    * @brief tests the RDM packet in receivedData() against the checksum accumulated while it was read
+    * @return 1 if start code, length and checksum are valid
+   */
+  	uint8_t validateReceivedRDMPacket( void );
+#endif
+  	
+#if defined LXSAMD51DMX_TRACE
+  	/*!
+    * @brief adds an event to the trace ring, called only from the interrupt handler
+    * @discussion if the ring is full the event is dropped and counted
+   */
+  	void traceEvent( uint8_t event, uint16_t data );
+#endif
    
+#if LXSAMD51DMX_INPUT
    /*!
     * @brief Function called when DMX frame has been read
     * @discussion Sets a pointer to a function that is called
@@ -241,8 +562,38 @@ class LXSAMD51DMX  {
    */
    void setDataReceivedCallback(LXRecvCallback callback);
    
+   /*!
+    * @brief selects where the data and RDM received callbacks are called
+    * @discussion LX_CALLBACK_DIRECT (default) calls them from the SERCOM interrupt when a packet is complete.
+    *             LX_CALLBACK_DEFERRED only records the packet there and pends LXSAMD51DMX_DEFER_IRQn.
+    *             The callbacks then run from LXSAMD51DMX_DEFER_HANDLER, below the SERCOM interrupt which
+    *             is raised one priority level, so a slow callback does not hold up reading the next packet.
+    *             Packets completed before their callback runs are reported once with the latest length.
+   */
+   void    setCallbackMode( uint8_t mode );
+   uint8_t callbackMode( void );
+   
+   /*!
+    * @brief calls the callbacks recorded in LX_CALLBACK_DEFERRED mode, called from LXSAMD51DMX_DEFER_HANDLER
+   */
+   void    runDeferredCallbacks( void );
+
+#if defined LXSAMD51DMX_FREERTOS
+   /*!
+    * @brief task notified when packets are received
+    * @discussion LX_NOTIFY_DMX and LX_NOTIFY_RDM are set in its notification value from the SERCOM interrupt,
+    *             in addition to calling any callbacks.  Wait with
+    *             xTaskNotifyWait(0, LX_NOTIFY_DMX | LX_NOTIFY_RDM, &bits, portMAX_DELAY).
+    *             The same task may send RDM requests, LX_NOTIFY_BUS is reserved for them.
+    * @param task NULL (default) notifies no task
+   */
+   void    setNotifyTask( TaskHandle_t task );
+#endif
+#endif
+   
    /************************************ RDM Methods ***********************************/
    
+#if LXSAMD51DMX_RDM
    /*!
     * @brief Function called when RDM frame has been read
     * @discussion Sets a pointer to a function that is called
@@ -251,14 +602,20 @@ class LXSAMD51DMX  {
     *             Best used to set a flag that is polled outside of ISR for available data.
     */
    void setRDMReceivedCallback(LXRecvCallback callback);
+#endif
    
    /*!
     * @brief interrupt handler functions
    */
+#if LXSAMD51DMX_OUTPUT
    void outputIRQHandler();
+#endif
+#if LXSAMD51DMX_INPUT
    void inputIRQHandler();
+#endif
+#if LXSAMD51DMX_RDM
    void rdmIRQHandler();
-   
+
       	/*!
     * @brief indicate if dmx frame should be sent by bi-directional task loop
     * @discussion should only be called by task loop
@@ -278,6 +635,7 @@ class LXSAMD51DMX  {
     * @brief sets rdm task to send mode after task mode loops.
     *        Sent after sending RDM message so DMX is resumed.
     *        Blocks until task loop sets mode to send.
+    *        Returns immediately if output has already resumed at the end of a response window.
 	*/
 	void restoreTaskSendDMX( void );
 	
@@ -302,8 +660,17 @@ class LXSAMD51DMX  {
     *             set _rdm_read_handled flag prior to calling sendRawRDMPacket
     *             _rdm_read_handled = 1 if reading is handled by calling function
     *             _rdm_read_handled = 0 if desired to resume passive listening for next break
+    *
+    *             When reading is handled, returns at the end of the response window with the
+    *             response in _receivedData.  The ISR has then given the line back to DMX or
+    *             holds it for the next request (see setMinimumDMXRate).
     */
-	void sendRawRDMPacket( uint8_t len );
+	void sendRawRDMPacket( uint16_t len );
+	
+	/*!
+    * @brief first half of sendRawRDMPacket, returns once _rdmPacket is scheduled to be sent
+	*/
+	void startRawRDMPacket( uint16_t len );
 	
 	/*!
     * @brief convenience method for setting fields in the top 20 bytes of an RDM message
@@ -318,6 +685,7 @@ class LXSAMD51DMX  {
     *        that will be sent.
     *        Destination UID needs to be set outside this method.
     *        Source UID is set to static member THIS_DEVICE_ID
+    *        If a message queue is set, its count replaces msgs.
 	*/
 	void  setupRDMDevicePacket(uint8_t* pdata, uint8_t msglen, uint8_t rtype, uint8_t msgs, uint16_t subdevice);
 	
@@ -329,16 +697,16 @@ class LXSAMD51DMX  {
 	
 	/*!
     * @brief send discovery packet using upper and lower bounds
-	* @discussion Assumes that regular DMX was sending when method is called and 
-	*             so restores sending, waiting for a frame to be sent before returning.
+	* @discussion Assumes that regular DMX was sending when method is called.
+	*             DMX output resumes when the response window ends.
     * @return 1 if discovered, 2 if valid packet (UID stored in uldata[12-17])
     */
     uint8_t sendRDMDiscoveryPacket(UID* lower, UID* upper, UID* single);
     
     /*!
     * @brief send discovery mute/un-mute packet to target UID
-	* @discussion Assumes that regular DMX was sending when method is called and 
-	*             so restores sending, waiting for a frame to be sent before returning.
+	* @discussion Assumes that regular DMX was sending when method is called.
+	*             DMX output resumes when the response window ends.
     * @return 1 if ack response is received.
     */
     uint8_t sendRDMDiscoveryMute(UID* target, uint8_t cmd);
@@ -357,25 +725,96 @@ class LXSAMD51DMX  {
     */
     uint8_t sendRDMControllerPacket( uint8_t* bytes, uint8_t len );
     
+    /*!
+    * @brief copies a complete packet into _rdmPacket and starts sending it, returns without waiting
+    * @discussion bytes starts with the RDM start code, the checksum is filled in as the packet is sent.
+    *             Works for DISC_UNIQUE_BRANCH as well as GET and SET.  Call rdmControllerPacketResult()
+    *             until the response window has ended.  Other controller methods must not be called meanwhile.
+    * @return 0 if a request is already in progress or the packet is not valid
+    */
+    uint8_t startRDMControllerPacket( uint8_t* bytes, uint16_t len );
+    
+    /*!
+    * @brief checks for the end of a request started with startRDMControllerPacket
+    * @discussion When the response window has ended, the bytes received, unchecked, are copied into
+    *             _rdmData (see receivedRDMData and receivedRDMLength).  An encoded discovery response
+    *             or a collision gives RDM_RESULT_CHECKSUM.
+    * @return RDM_RESULT_NONE while waiting, RDM_RESULT_ACK for a valid RDM packet,
+    *         RDM_RESULT_TIMEOUT if nothing was received or no request is in progress (stop() abandons one),
+    *         otherwise RDM_RESULT_CHECKSUM
+    */
+    uint8_t rdmControllerPacketResult( void );
+    
+    /*!
+    * @brief number of bytes copied into _rdmData by rdmControllerPacketResult
+    */
+    uint16_t receivedRDMLength( void );
+    
     /*!
     * @brief send RDM_GET_COMMAND packet
-	* @discussion Assumes that regular DMX was sending when method is called and 
-	*             so restores sending, waiting for a frame to be sent before returning.
+	* @discussion Assumes that regular DMX was sending when method is called.
+	*             DMX output resumes when the response window ends.
+	*             Up to len bytes of the response are copied into info.
+	*             ACK_OVERFLOW and ACK_TIMER are followed up as in sendRDMGetCommandLong.
+	*             If a response cache is set, static parameters are answered from it.
+    * @param subdevice 0 for the root device or 1-512
     * @return 1 if ack is received.
     */
-    uint8_t sendRDMGetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len);
+    uint8_t sendRDMGetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len, uint16_t subdevice=0);
+    
+    /*!
+    * @brief send RDM_GET_COMMAND packet for a parameter that may not fit in a single response
+	* @discussion ACK_OVERFLOW responses are requested again until the final ACK and
+	*             their data is copied directly from the receive buffer into info.
+	*             After ACK_TIMER, waits the estimated time and collects the response with QUEUED_MESSAGE.
+	*             Data past len is not copied but is counted in received.
+    * @param received (optional, may be NULL) total length of the parameter data
+    * @param subdevice 0 for the root device or 1-512
+    * @return 1 if the complete response is received.
+    */
+    uint8_t sendRDMGetCommandLong(UID* target, uint16_t pid, uint8_t* info, uint16_t len, uint16_t* received, uint16_t subdevice=0);
+    
+    /*!
+    * @brief send RDM_GET_COMMAND packet without looking in the response cache
+	* @discussion the cached response is replaced by the one received
+    * @return 1 if ack is received.
+    */
+    uint8_t refreshRDMGetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len, uint16_t subdevice=0);
     
     /*!
     * @brief send RDM_SET_COMMAND packet
-	* @discussion Assumes that regular DMX was sending when method is called and 
-	*             so restores sending, waiting for a frame to be sent before returning.
+	* @discussion Assumes that regular DMX was sending when method is called.
+	*             DMX output resumes when the response window ends.
+	*             After ACK_TIMER, the response is collected with QUEUED_MESSAGE.
+    * @param subdevice 0 for the root device, 1-512 or 0xFFFF for all sub-devices
     * @return 1 if ack is received.
     */
-    uint8_t sendRDMSetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len);
+    uint8_t sendRDMSetCommand(UID* target, uint16_t pid, uint8_t* info, uint8_t len, uint16_t subdevice=0);
+    
+    /*!
+    * @brief sends a list of GET and SET commands one after another
+	* @discussion Requests are retried according to setRDMRetryPolicy.
+	*             callback (may be NULL) is called as each request completes.
+	*             With setMinimumDMXRate, requests are sent back to back between DMX frames.
+    * @param stats (optional, may be NULL) filled with the throughput of the batch
+    * @return number of requests acknowledged
+    */
+    uint16_t sendRDMBatch(RDMBatchRequest* requests, uint16_t count, RDMBatchCallback callback, RDMBatchStats* stats=NULL);
+    
+    /*!
+    * @brief outcome of the last GET or SET command, RDM_RESULT_*
+    */
+    uint8_t  lastRDMResult( void );
+    
+    /*!
+    * @brief reason code of the last RDM_RESULT_NACK
+    */
+    uint16_t lastRDMNackReason( void );
     
     /*!
     * @brief send RDM_GET_COMMAND_RESPONSE with RDM_RESPONSE_TYPE_ACK
 	* @discussion sends data (info) of length (len)
+	*             sub-device is the one addressed by the request in receivedRDMData()
     */
     void sendRDMGetResponse(UID target, uint16_t pid, uint8_t* info, uint8_t len);
     
@@ -393,16 +832,281 @@ class LXSAMD51DMX  {
     */
     void sendRDMDiscoverBranchResponse( void );
     
+    /*!
+    * @brief enables answering discovery commands directly from the interrupt handler
+    * @discussion When enabled, DISC_UNIQUE_BRANCH, DISC_MUTE and DISC_UNMUTE are answered
+    *             for THIS_DEVICE_ID as soon as the packet is received, regardless of what loop() is doing.
+    *             These packets are not passed to the RDM received callback.
+    *             The encoded discovery response is prepared here, so set THIS_DEVICE_ID first.
+    */
+    void setAutoRDMDiscovery( uint8_t enable );
+    
+    /*!
+    * @brief discovery mute flag, set by DISC_MUTE and cleared by DISC_UNMUTE when auto discovery is enabled
+    */
+    uint8_t rdmDiscoveryMuted( void );
+    void    setRDMDiscoveryMuted( uint8_t muted );
+    
+    /*!
+    * @brief queue whose count is reported as the message count of device responses
+    * @discussion NULL (default) uses the msgs value passed to setupRDMDevicePacket
+    */
+    void setRDMMessageQueue( RDMMessageQueue* queue );
+    
+    /*!
+    * @brief cache used by sendRDMGetCommand for parameters that do not change
+    * @discussion NULL (default) sends every GET
+    */
+    void setRDMResponseCache( RDMResponseCache* cache );
+    RDMResponseCache* rdmResponseCache( void );
+    
+    /*!
+    * @brief counts of responses, timeouts, checksum failures, NACKs and latency for each device
+    * @discussion NULL (default) counts nothing
+    */
+    void setRDMDeviceStats( RDMDeviceStats* stats );
+    RDMDeviceStats* rdmDeviceStats( void );
+    
+    /*!
+    * @brief how a controller request is repeated when it gets no valid response
+    * @discussion A response must come from the target, be addressed to THIS_DEVICE_ID and
+    *             carry the transaction number of the request, so a late reply to an earlier
+    *             request is not taken for this one.  Each retry is sent with a new transaction number.
+    *             Applies to GET, SET and DISC_MUTE/DISC_UNMUTE, not to DISC_UNIQUE_BRANCH or broadcasts.
+    * @param retries number of times a request is sent again, default RDM_DEFAULT_RETRIES
+    * @param backoff_ms wait before the first retry, doubled for each one after, default RDM_DEFAULT_BACKOFF_MS
+    */
+    void setRDMRetryPolicy( uint8_t retries, uint16_t backoff_ms );
+    
+    /*!
+    * @brief microseconds from the end of the last request to the start of its response, 44us resolution
+    */
+    uint16_t lastRDMLatency( void );
+    
+    /*!
+    * @brief guarantees a DMX refresh rate while RDM requests are being sent
+    * @discussion A request waits for the end of a DMX frame and is sent only if the transaction
+    *             is expected to finish before the next frame is due.  Further requests are sent
+    *             back to back while they fit.  The expected length of a transaction follows the
+    *             longest measured one and decays toward shorter ones.  If a request finds no room for RDM_MAX_DEFERRED_FRAMES
+    *             frames, it is sent anyway.
+    * @param hz minimum DMX frames per second, 0 (default) sends one DMX frame between requests
+    */
+    void setMinimumDMXRate( uint8_t hz );
+    
+    /*!
+    * @brief time the line is left undriven between the end of a received RDM packet and sending the next one
+    * @discussion The line driver stays off while 44us slots are clocked out.  Slots are counted from
+    *             the end of the received packet, so a response sent from loop() goes out as soon as the
+    *             turnaround has passed.  Measured turnaround is in getBusStats().
+    * @param us clamped to RDM_TURNAROUND_MIN_US to RDM_TURNAROUND_MAX_US, default RDM_TURNAROUND_MIN_US
+    */
+    void setRDMTurnaround( uint16_t us );
+    uint16_t rdmTurnaround( void );
+
+#if defined LXSAMD51DMX_FREERTOS
+    /*!
+    * @brief holds the bus for RDM requests from the calling task, may be nested
+    * @discussion Each RDM method takes the bus while it runs, so requests from other tasks wait their turn.
+    *             Lock it around several requests to keep them together.  Does nothing before the scheduler starts.
+    */
+    void lockBus( void );
+    void unlockBus( void );
+#endif
+#endif
+    
+    /*!
+    * @brief copies counts of DMX frames and RDM transactions and the rates achieved since resetBusStats()
+    */
+    void getBusStats( LXDMXBusStats* stats );
+    void resetBusStats( void );
+
+#if defined LXSAMD51DMX_PROFILE
+    /*!
+    * @brief copies the timing of each handler, profiles must have room for LX_PROFILE_COUNT entries
+    */
+    void getProfile( LXISRProfile* profiles );
+    
+    /*!
+    * @brief clears the handler timing and starts the DWT cycle counter
+    */
+    void resetProfile( void );
+    
+    /*!
+    * @brief prints count, min, max and mean cycles and the histogram of each handler
+    */
+    void printProfile( Print& out );
+    
+    /*!
+    * @brief adds a sample to a handler's timing, called from the interrupt handlers
+    */
+    void recordProfile( uint8_t handler, uint32_t cycles );
+#endif
+
+#if defined LXSAMD51DMX_TRACE
+    /*!
+    * @brief number of trace events waiting to be read
+    */
+    uint16_t traceCount( void );
+    
+    /*!
+    * @brief removes the oldest trace event
+    * @return 1 if an event was copied to event, 0 if the ring is empty
+    */
+    uint8_t readTraceEvent( LXTraceEvent* event );
+    
+    /*!
+    * @brief writes waiting trace events to out in binary blocks, call from loop()
+    * @discussion Each block is LX_TRACE_BLOCK_START, the event count (up to LX_TRACE_BLOCK_EVENTS),
+    *             the number of events dropped because the ring was full (16 bit) and then
+    *             LX_TRACE_EVENT_SIZE bytes per event: time_us (32 bit), event, state, data (16 bit).
+    *             Multi-byte values are little endian.  Each block is a single write.
+    * @return number of events written
+    */
+    uint16_t drainTrace( Print& out );
+    
+    /*!
+    * @brief discards waiting trace events
+    */
+    void resetTrace( void );
+#endif
+    
     static UID THIS_DEVICE_ID;
 
     
   private:
+  
+#if LXSAMD51DMX_RDM
+	/*!
+	 * @brief answers discovery packet addressed to THIS_DEVICE_ID from ISR
+	 * @return 1 if the packet was a discovery command and has been handled
+	 */
+	uint8_t autoRDMDiscovery( void );
+	
+	/*!
+	 * @brief fills _disc_response with the encoded UID and checksum of THIS_DEVICE_ID
+	 */
+	void encodeRDMDiscoveryResponse( void );
+	
+	/*!
+	 * @brief starts sending packet without blocking, may be called from ISR
+	 * @discussion Line driver stays off for what remains of the turnaround,
+	 *             then the packet is sent with or without a break.  Switches to receive when done.
+	 */
+	void startRDMTransmit( uint8_t* packet, uint16_t len, uint8_t with_break );
+	
+	/*!
+	 * @brief number of 44us slots (at least 1) still needed to complete the turnaround
+	 */
+	uint8_t turnaroundSlots( void );
+	
+	/*!
+	 * @brief enables the line driver at the end of the guard slots, records the turnaround
+	 */
+	void takeLine( void );
+	
+	/*!
+	 * @brief sends _rdmPacket, DMX output is restored by the ISR
+	 * @return 1 if a valid response was received and is in _receivedData
+	 */
+	uint8_t rdmTransaction( void );
+	
+	/*!
+	 * @brief 1 if the response window that follows a controller request is over, called from ISR
+	 */
+	uint8_t rdmResponseEnded( void );
+	
+	/*!
+	 * @brief 1 if an RDM transaction is expected to finish before the next DMX frame is due
+	 */
+	uint8_t rdmFitsBeforeDMX( void );
+	
+	/*!
+	 * @brief called from ISR when the line is given back after DMX_STATE_HOLD
+	 * @discussion the direction pin is set once the last filler slot has been sent
+	 */
+	void    endRDMHold( void );
+	
+	/*!
+	 * @brief 1 if an RDM response has started but not all of its slots have been received
+	 */
+	uint8_t rdmResponseIncomplete( void );
+	
+	/*!
+	 * @brief sub-device of the request in _rdmData, responses are sent for the same sub-device
+	 */
+	uint16_t receivedRDMSubdevice( void );
+	
+	/*!
+	 * @brief sends _rdmPacket to target until a response matching the request is received or retries are used up
+	 * @discussion counts each attempt in the device stats
+	 * @return 1 if a valid response was received
+	 */
+	uint8_t rdmExchange( UID* target );
+	
+	/*!
+	 * @brief 1 if the response in _receivedData answers the request in _rdmPacket sent to target
+	 */
+	uint8_t rdmResponseMatches( UID* target );
+	
+	/*!
+	 * @brief sends _rdmPacket and follows ACK_OVERFLOW and ACK_TIMER responses from target
+	 * @return 1 if the final ACK was received
+	 */
+	uint8_t completeRDMTransaction(UID* target, uint8_t cmdclass, uint16_t pid, uint16_t subdevice, uint8_t* info, uint16_t len, uint16_t* received);
+#endif
+
+	/*!
+	 * @brief drives the direction pin with a PORT register write, safe and fast in the ISR
+	 */
+	void    setDirection( uint8_t level );
+
+#if defined LXSAMD51DMX_FREERTOS
+	/*!
+	 * @brief blocks the task holding the bus until the ISR signals a change or LX_RTOS_WAIT_MS passes
+	 * @return 0 if the task can't block (scheduler not running or bus not locked), the caller polls instead
+	 */
+	uint8_t waitForISR( void );
+	
+	/*!
+	 * @brief signals the task waiting in waitForISR, called from ISR
+	 */
+	void    wakeBusOwner( void );
+	
+	/*!
+	 * @brief sets bits in the notification value of task, from the interrupt handler or from a task
+	 */
+	void    notifyTask( TaskHandle_t task, uint32_t bits );
+	
+	/*!
+	 * @brief sleeps the task, or delays when the scheduler is not running
+	 */
+	void    sleepMS( uint32_t ms );
+#endif
+
+#if LXSAMD51DMX_INPUT
+	/*!
+	 * @brief records a packet for runDeferredCallbacks and pends the spare interrupt, called from ISR
+	 */
+	void    deferCallback( uint8_t event, uint16_t len );
+	
+	/*!
+	 * @brief sets the SERCOM and spare interrupt priorities for the callback mode, after SerialDMX.begin()
+	 */
+	void    setInterruptPriorities( void );
+#endif
   	
   	/*!
    * @brief pin used to control direction of output driver chip
    */
   	uint8_t _direction_pin;
   	
+  	/*!
+   * @brief PORT group and bit of _direction_pin, mask is 0 if not used
+   */
+  	PortGroup* _direction_port;
+  	uint32_t   _direction_mask;
+  	
   	/*!
 	 * @brief represents phase of sending dmx packet data/break/etc used to change baud settings
 	 */
@@ -448,21 +1152,225 @@ class LXSAMD51DMX  {
 	 */
   	uint16_t  _slots;
   	
+#if LXSAMD51DMX_RDM
 	/*!
 	 * @brief outgoing rdm packet length
 	 */
 	uint16_t  _rdm_len;
+	
+	/*!
+	 * @brief index of checksum in outgoing rdm packet, zero if packet already contains its checksum
+	 */
+	uint16_t  _rdm_checksum_slot;
+	
+	/*!
+	 * @brief checksum of outgoing rdm packet, accumulated as bytes are sent
+	 */
+	uint16_t  _rdm_send_checksum;
+	
+	/*!
+	 * @brief number of received bytes covered by the checksum (RDM message length)
+	 */
+	uint16_t  _rdm_read_checksum_len;
+	
+	/*!
+	 * @brief checksum of received rdm packet, accumulated as bytes are read
+	 */
+	uint16_t  _rdm_read_checksum;
+	
+	/*!
+	 * @brief packet being sent, _rdmPacket or one of the automatic responses
+	 */
+	uint8_t*  _rdm_send_buffer;
+	
+	/*!
+	 * @brief flag indicating packet being sent starts with a break
+	 */
+	uint8_t   _rdm_send_break;
+	
+	/*!
+	 * @brief remaining turnaround slots before the line driver is enabled
+	 */
+	uint8_t   _guard_slots;
+	
+	/*!
+	 * @brief turnaround set by setRDMTurnaround
+	 */
+	uint16_t  _turnaround_us;
+	
+	/*!
+	 * @brief micros() at the end of the last received RDM packet, valid until the line is taken
+	 */
+	uint32_t  _rdm_rx_end_us;
+	uint8_t   _rdm_rx_end_valid;
+	
+	/*!
+	 * @brief flag indicating discovery is answered from ISR
+	 */
+	uint8_t   _rdm_auto_discovery;
+	
+	/*!
+	 * @brief discovery mute flag
+	 */
+	volatile uint8_t _rdm_discovery_muted;
+	
+	/*!
+	 * @brief encoded response to DISC_UNIQUE_BRANCH
+	 */
+	uint8_t  _disc_response[RDM_DISC_RESPONSE_FRAME];
+	
+	/*!
+	 * @brief DISC_MUTE/DISC_UNMUTE response built in ISR
+	 */
+	uint8_t  _rdm_auto_packet[RDM_MUTE_RESPONSE_LEN];
+	
+	/*!
+	 * @brief queued messages reported in responses
+	 */
+	RDMMessageQueue* _rdm_message_queue;
+	
+	/*!
+	 * @brief GET responses kept by controller
+	 */
+	RDMResponseCache* _rdm_cache;
+	
+	/*!
+	 * @brief per device counts kept by controller
+	 */
+	RDMDeviceStats* _rdm_device_stats;
+	
+	/*!
+	 * @brief outcome of last controller transaction
+	 */
+	uint8_t   _rdm_result;
+	uint16_t  _rdm_nack_reason;
+	
+	/*!
+	 * @brief retry policy, see setRDMRetryPolicy
+	 */
+	uint8_t   _rdm_retries;
+	uint16_t  _rdm_backoff_ms;
+	
+	/*!
+	 * @brief flag set while a request started with startRDMControllerPacket is in progress
+	 */
+	uint8_t   _rdm_async_pending;
+	uint16_t  _rdm_received_len;
+	
+	/*!
+	 * @brief filler slots in DMX_STATE_LISTEN before the response started, 0 if none
+	 */
+	volatile uint16_t _rdm_reply_slots;
+	
+	/*!
+	 * @brief filler slots sent in DMX_STATE_LISTEN or DMX_STATE_HOLD
+	 */
+	uint16_t  _hold_slots;
+	
+	/*!
+	 * @brief flag set by ISR when the response window of a controller request has ended
+	 */
+	volatile uint8_t _rdm_response_ready;
+	
+	/*!
+	 * @brief maximum break to break time of DMX frames, 0 if not scheduled
+	 */
+	uint32_t  _dmx_min_period_us;
+	
+	/*!
+	 * @brief micros() at start of current RDM request
+	 */
+	uint32_t  _rdm_start_us;
+	
+	/*!
+	 * @brief expected transaction length, from measured ones
+	 */
+	uint32_t  _rdm_cost_us;
+	
+	/*!
+	 * @brief DMX frames sent since a request started waiting for room
+	 */
+	uint8_t   _rdm_deferred_frames;
+#endif
+	
+	/*!
+	 * @brief micros() at start of last DMX frame
+	 */
+	uint32_t  _last_dmx_start_us;
+	
+	LXDMXBusStats _bus_stats;
+	uint32_t  _bus_stats_start_ms;
+	
+#if defined LXSAMD51DMX_FREERTOS
+	/*!
+	 * @brief recursive mutex held during RDM requests and the task holding it
+	 */
+	SemaphoreHandle_t     _bus_mutex;
+#if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+	StaticSemaphore_t     _bus_mutex_buffer;
+#endif
+	volatile TaskHandle_t _bus_owner;
+	uint8_t               _bus_lock_depth;
+	
+	/*!
+	 * @brief flag set while a request started with startRDMControllerPacket holds the bus
+	 */
+	uint8_t               _rdm_async_locked;
+	
+	TaskHandle_t          _notify_task;
+#endif
+	
+#if defined LXSAMD51DMX_PROFILE
+	LXISRProfile _profile[LX_PROFILE_COUNT];
+#endif
+
+#if defined LXSAMD51DMX_TRACE
+	LXTraceEvent _trace[LX_TRACE_DEPTH];
+	/*!
+	 * @brief free running indexes, written by the interrupt handler (head) and the main loop (tail)
+	 */
+	volatile uint16_t _trace_head;
+	volatile uint16_t _trace_tail;
+	volatile uint16_t _trace_dropped;
+#endif
+  	
+	/*!
+	 * @brief dmx data including start code, the frame being sent
+	 */
+  	uint8_t* _dmxData;
   	
 	/*!
-	 * @brief Array of dmx data including start code
+	 * @brief frame being filled through dmxBackBuffer() and the last committed frame,
+	 *        which replaces _dmxData at the next break
 	 */
-  	uint8_t  _dmxData[DMX_MAX_FRAME];
+  	uint8_t* _dmx_back;
+  	uint8_t* _dmx_ready;
+  	volatile uint8_t _dmx_ready_flag;
+  	uint16_t _dmx_ready_slots;
+  	
+  	uint8_t  _dmx_buffers[LXSAMD51DMX_DMX_BUFFERS][LXSAMD51DMX_MAX_FRAME];
   	
+#if LXSAMD51DMX_INPUT
 	/*!
 	 * @brief Array of received bytes first byte is start code
 	 */
-  	uint8_t  _receivedData[DMX_MAX_FRAME];
+  	uint8_t  _receivedData[LXSAMD51DMX_RECEIVE_SIZE];
   	
+	/*!
+	 * @brief twice the frames received, odd while the ISR copies a frame to _dmxData
+	 */
+  	volatile uint32_t _frame_sequence;
+  	
+	/*!
+	 * @brief LX_CALLBACK_DIRECT or LX_CALLBACK_DEFERRED, LX_DEFERRED_ events and their lengths
+	 */
+  	uint8_t  _callback_mode;
+  	volatile uint8_t _deferred_events;
+  	uint16_t _deferred_slots;
+  	uint16_t _deferred_rdm_len;
+#endif
+  	
+#if LXSAMD51DMX_RDM
   	/*!
 	 * @brief Array representing an rdm packet to be sent
 	 */
@@ -471,7 +1379,12 @@ class LXSAMD51DMX  {
 	/*!
 	 * @brief Array representing a received rdm packet
 	 */
+#if LXSAMD51DMX_SHARED_RDM_BUFFER
+	uint8_t* const _rdmData = _receivedData;
+#else
 	uint8_t  _rdmData[RDM_MAX_FRAME];
+#endif
+#endif
   	
    /*!
     * @brief Pointer to receive callback function
@@ -539,6 +1452,9 @@ extern LXSAMD51DMX SAMD51DMX;
 	// sercomN is C++ wrapper for SERCOMn (passed to UART constructor)
 	#define DMX_sercom sercom2
 
+	// first of the SERCOM's four interrupts
+	#define DMX_SERCOM_IRQn SERCOM2_0_IRQn
+
 	// sercom handler function
 	#define DMX_SERCOM_HANDLER_FUNC LX_SERCOM_Handler
 		
@@ -599,6 +1515,9 @@ extern LXSAMD51DMX SAMD51DMX;
 	// sercomN is C++ wrapper for SERCOMn (passed to UART constructor)
 	#define DMX_sercom sercom4
 
+	// first of the SERCOM's four interrupts
+	#define DMX_SERCOM_IRQn SERCOM4_0_IRQn
+
 	// sercom handler function
 	#define DMX_SERCOM_HANDLER_FUNC LX_SERCOM_Handler
 	
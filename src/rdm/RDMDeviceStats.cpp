@@ -0,0 +1,96 @@
+/**************************************************************************/
+/*!
+    @file     RDMDeviceStats.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <Arduino.h>
+#include <LXSAMD51DMX.h>
+#include <rdm/RDMDeviceStats.h>
+
+RDMDeviceStats::RDMDeviceStats ( void ) {
+	reset();
+}
+
+void RDMDeviceStats::reset( void ) {
+	memset(_entries, 0, sizeof(_entries));
+	_count = 0;
+}
+
+const RDMDeviceStatsEntry* RDMDeviceStats::find( UID* target ) {
+	for (uint8_t j=0; j<_count; j++) {
+		if ( *target == _entries[j].uid ) {
+			return &_entries[j];
+		}
+	}
+	return NULL;
+}
+
+void RDMDeviceStats::record(UID* target, uint8_t result, uint16_t latency_us) {
+	RDMDeviceStatsEntry* entry = (RDMDeviceStatsEntry*)find(target);
+	if ( entry == NULL ) {
+		if ( _count == RDM_STATS_ENTRIES ) {
+			return;
+		}
+		entry = &_entries[_count++];
+		UID::copyFromUID(*target, entry->uid);
+	}
+	
+	entry->requests++;
+	switch ( result ) {
+		case RDM_RESULT_NACK:
+			entry->nacks++;
+			// a NACK is also a response
+			// fall through
+		case RDM_RESULT_ACK:
+			if ( entry->responses == 0 ) {
+				entry->latency_us = latency_us;
+			} else {
+				entry->latency_us = ( 3 * (uint32_t)entry->latency_us + latency_us ) >> 2;
+			}
+			if ( latency_us > entry->max_latency_us ) {
+				entry->max_latency_us = latency_us;
+			}
+			entry->responses++;
+			break;
+		case RDM_RESULT_TIMEOUT:
+			entry->timeouts++;
+			break;
+		case RDM_RESULT_CHECKSUM:
+			entry->checksum_failures++;
+			break;
+		default:
+			entry->mismatches++;
+			break;
+	}
+}
+
+uint8_t RDMDeviceStats::count( void ) {
+	return _count;
+}
+
+const RDMDeviceStatsEntry* RDMDeviceStats::entry( uint8_t index ) {
+	if ( index < _count ) {
+		return &_entries[index];
+	}
+	return NULL;
+}
+
+const RDMDeviceStatsEntry* RDMDeviceStats::slowest( void ) {
+	RDMDeviceStatsEntry* slow = NULL;
+	for (uint8_t j=0; j<_count; j++) {
+		if ( _entries[j].responses && ( ( slow == NULL ) || ( _entries[j].latency_us > slow->latency_us ) ) ) {
+			slow = &_entries[j];
+		}
+	}
+	return slow;
+}
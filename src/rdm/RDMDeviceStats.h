@@ -0,0 +1,99 @@
+/**************************************************************************/
+/*!
+    @file     RDMDeviceStats.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    Implements counts of controller transactions for each device
+    in a fixed size table
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef RDMDeviceStats_h
+#define RDMDeviceStats_h
+
+#include <stdint.h>
+#include <rdm/rdm_utility.h>
+#include <rdm/UID.h>
+
+// number of devices counted
+#define RDM_STATS_ENTRIES		32
+
+/*!
+ * @brief counts for one device
+ * @discussion Every packet sent to the device is counted in requests, including retries.
+ *             latency_us is a running average of the time from the end of a request to the
+ *             start of the response, measured in 44us slots.
+ */
+typedef struct {
+	uint8_t  uid[6];
+	uint32_t requests;
+	uint32_t responses;			// valid responses, including NACKs
+	uint32_t nacks;
+	uint32_t timeouts;
+	uint32_t checksum_failures;	// corrupted or incomplete responses
+	uint32_t mismatches;		// responses with the wrong transaction number or UID
+	uint16_t latency_us;
+	uint16_t max_latency_us;
+} RDMDeviceStatsEntry;
+
+/*!
+@class RDMDeviceStats
+@abstract
+   RDMDeviceStats counts the outcome of each packet LXSAMD51DMX sends to a device
+   once attached with LXSAMD51DMX::setRDMDeviceStats().
+
+   A device is added the first time a packet is sent to it.  When the table is full,
+   further devices are not counted.  Broadcast requests are not counted.
+*/
+
+class RDMDeviceStats {
+
+  public:
+
+	RDMDeviceStats ( void );
+
+	/*!
+	 * @brief counts a packet sent to target
+	 * @param result RDM_RESULT_ACK for any valid response other than NACK, otherwise RDM_RESULT_*
+	 * @param latency_us time to the start of the response, used if there was one
+	 */
+	void    record(UID* target, uint8_t result, uint16_t latency_us);
+
+	/*!
+	 * @brief counts for target
+	 * @return NULL if target has not been counted
+	 */
+	const RDMDeviceStatsEntry* find( UID* target );
+
+	/*!
+	 * @brief number of devices counted, entries 0 to count-1
+	 */
+	uint8_t count( void );
+	const RDMDeviceStatsEntry* entry( uint8_t index );
+
+	/*!
+	 * @brief device with the highest average latency
+	 * @return NULL if no response has been counted
+	 */
+	const RDMDeviceStatsEntry* slowest( void );
+
+	/*!
+	 * @brief removes all devices
+	 */
+	void    reset( void );
+
+  private:
+
+	RDMDeviceStatsEntry  _entries[RDM_STATS_ENTRIES];
+	uint8_t              _count;
+};
+
+#endif	//RDMDeviceStats_h
@@ -0,0 +1,112 @@
+/**************************************************************************/
+/*!
+    @file     RDMMessageQueue.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <Arduino.h>
+#include <rdm/RDMMessageQueue.h>
+
+RDMMessageQueue::RDMMessageQueue ( void ) {
+	reset();
+}
+
+void RDMMessageQueue::reset( void ) {
+	_head = 0;
+	_tail = 0;
+	_has_last = 0;
+	_status_count = 0;
+	_last_status_len = 0;
+}
+
+uint8_t RDMMessageQueue::queueMessage(uint8_t cmdclass, uint16_t pid, const uint8_t* data, uint8_t pdl, uint16_t subdevice) {
+	if ( ( count() >= RDM_QUEUE_DEPTH ) || ( pdl > RDM_QUEUE_MAX_PDL ) ) {
+		return 0;
+	}
+	RDMQueuedMessage* msg = &_messages[_head & (RDM_QUEUE_DEPTH-1)];
+	msg->pid = pid;
+	msg->subdevice = subdevice;
+	msg->cmdclass = cmdclass;
+	msg->pdl = pdl;
+	memcpy(msg->data, data, pdl);
+	_head++;								// publish after message is complete
+	return 1;
+}
+
+void RDMMessageQueue::queueStatus(uint8_t type, uint16_t message_id, uint16_t data1, uint16_t data2, uint16_t subdevice) {
+	if ( _status_count == RDM_STATUS_QUEUE_DEPTH ) {		// full, drop oldest
+		memmove(&_status[0], &_status[1], (RDM_STATUS_QUEUE_DEPTH-1)*sizeof(RDMStatusMessage));
+		_status_count--;
+	}
+	RDMStatusMessage* status = &_status[_status_count++];
+	status->subdevice = subdevice;
+	status->type = type;
+	status->message_id = message_id;
+	status->data1 = data1;
+	status->data2 = data2;
+}
+
+uint8_t RDMMessageQueue::count( void ) {
+	return (uint8_t)(_head - _tail);
+}
+
+const RDMQueuedMessage* RDMMessageQueue::next( void ) {
+	if ( count() == 0 ) {
+		return NULL;
+	}
+	_last = _messages[_tail & (RDM_QUEUE_DEPTH-1)];
+	_has_last = 1;
+	_tail++;
+	return &_last;
+}
+
+const RDMQueuedMessage* RDMMessageQueue::last( void ) {
+	if ( _has_last ) {
+		return &_last;
+	}
+	return NULL;
+}
+
+uint8_t RDMMessageQueue::statusMessages(uint8_t type, uint8_t* data, uint8_t max_len) {
+	if ( type == RDM_STATUS_GET_LAST_MESSAGE ) {
+		uint8_t len = ( _last_status_len < max_len ) ? _last_status_len : max_len;
+		memcpy(data, _last_status, len);
+		return len;
+	}
+	if ( type == RDM_STATUS_NONE ) {
+		return 0;
+	}
+
+	uint8_t len = 0;
+	uint8_t kept = 0;
+	for (uint8_t j=0; j<_status_count; j++) {
+		RDMStatusMessage* status = &_status[j];
+		if ( ( status->type >= type ) && ( len + RDM_STATUS_MESSAGE_SIZE <= max_len ) ) {
+			data[len++] = status->subdevice >> 8;
+			data[len++] = status->subdevice & 0xFF;
+			data[len++] = status->type;
+			data[len++] = status->message_id >> 8;
+			data[len++] = status->message_id & 0xFF;
+			data[len++] = status->data1 >> 8;
+			data[len++] = status->data1 & 0xFF;
+			data[len++] = status->data2 >> 8;
+			data[len++] = status->data2 & 0xFF;
+		} else {
+			_status[kept++] = *status;		// not requested or no room, keep for later
+		}
+	}
+	_status_count = kept;
+
+	memcpy(_last_status, data, len);
+	_last_status_len = len;
+	return len;
+}
@@ -0,0 +1,139 @@
+/**************************************************************************/
+/*!
+    @file     RDMMessageQueue.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    Implements queued and status messages for an RDM responder
+    in fixed size ring buffers
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef RDMMessageQueue_h
+#define RDMMessageQueue_h
+
+#include <stdint.h>
+#include <rdm/rdm_utility.h>
+
+// number of queued messages, must be a power of two
+#define RDM_QUEUE_DEPTH			8
+// largest parameter data of a queued message
+#define RDM_QUEUE_MAX_PDL		32
+// number of status messages
+#define RDM_STATUS_QUEUE_DEPTH	8
+// size of a status message in STATUS_MESSAGES parameter data
+#define RDM_STATUS_MESSAGE_SIZE	9
+
+/*!
+ * @brief a response waiting to be collected with GET QUEUED_MESSAGE
+ */
+typedef struct {
+	uint16_t pid;
+	uint16_t subdevice;
+	uint8_t  cmdclass;			// RDM_GET_COMMAND_RESPONSE or RDM_SET_COMMAND_RESPONSE
+	uint8_t  pdl;
+	uint8_t  data[RDM_QUEUE_MAX_PDL];
+} RDMQueuedMessage;
+
+/*!
+ * @brief an entry reported by STATUS_MESSAGES
+ */
+typedef struct {
+	uint16_t subdevice;
+	uint8_t  type;
+	uint16_t message_id;
+	uint16_t data1;
+	uint16_t data2;
+} RDMStatusMessage;
+
+/*!
+@class RDMMessageQueue
+@abstract
+   RDMMessageQueue holds responses a controller collects with GET QUEUED_MESSAGE
+   and status messages it collects with GET STATUS_MESSAGES.
+
+   Storage is fixed size.  queueMessage fails when the queue is full.
+   When the status messages are full, the oldest is replaced.
+
+   The number of queued messages is reported in the message count of every response
+   sent by SAMD51DMX once the queue is attached with LXSAMD51DMX::setRDMMessageQueue().
+*/
+
+class RDMMessageQueue {
+
+  public:
+
+	RDMMessageQueue ( void );
+
+	/*!
+	 * @brief adds a response to the queue
+	 * @param cmdclass RDM_GET_COMMAND_RESPONSE or RDM_SET_COMMAND_RESPONSE
+	 * @return 0 if the queue is full or pdl is larger than RDM_QUEUE_MAX_PDL, otherwise 1
+	 */
+	uint8_t queueMessage(uint8_t cmdclass, uint16_t pid, const uint8_t* data, uint8_t pdl, uint16_t subdevice);
+
+	/*!
+	 * @brief adds a status message, replacing the oldest if full
+	 * @param type RDM_STATUS_ADVISORY, RDM_STATUS_WARNING or RDM_STATUS_ERROR
+	 */
+	void    queueStatus(uint8_t type, uint16_t message_id, uint16_t data1, uint16_t data2, uint16_t subdevice);
+
+	/*!
+	 * @brief number of queued messages waiting to be collected
+	 */
+	uint8_t count( void );
+
+	/*!
+	 * @brief removes the oldest queued message
+	 * @return pointer to the message, valid until the next call, or NULL if the queue is empty
+	 */
+	const RDMQueuedMessage* next( void );
+
+	/*!
+	 * @brief the message last returned by next(), for RDM_STATUS_GET_LAST_MESSAGE
+	 * @return NULL if no message has been collected
+	 */
+	const RDMQueuedMessage* last( void );
+
+	/*!
+	 * @brief copies status messages of type or higher severity into data and removes them
+	 * @discussion RDM_STATUS_GET_LAST_MESSAGE repeats the messages previously returned.
+	 * @return length of status message data, a multiple of RDM_STATUS_MESSAGE_SIZE
+	 */
+	uint8_t statusMessages(uint8_t type, uint8_t* data, uint8_t max_len);
+
+	/*!
+	 * @brief removes all queued and status messages
+	 */
+	void    reset( void );
+
+  private:
+
+	RDMQueuedMessage  _messages[RDM_QUEUE_DEPTH];
+	RDMQueuedMessage  _last;
+	uint8_t           _has_last;
+
+	/*!
+	 * @brief free running indexes, count is _head - _tail
+	 */
+	volatile uint8_t  _head;
+	volatile uint8_t  _tail;
+
+	RDMStatusMessage  _status[RDM_STATUS_QUEUE_DEPTH];
+	uint8_t           _status_count;
+
+	/*!
+	 * @brief status message data last returned by statusMessages()
+	 */
+	uint8_t           _last_status[RDM_STATUS_QUEUE_DEPTH*RDM_STATUS_MESSAGE_SIZE];
+	uint8_t           _last_status_len;
+};
+
+#endif	//RDMMessageQueue_h
@@ -0,0 +1,555 @@
+/**************************************************************************/
+/*!
+    @file     RDMResponder.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <Arduino.h>
+#include <rdm/RDMResponder.h>
+
+#if LXSAMD51DMX_RDM
+
+RDMResponder* RDMResponder::_active = NULL;
+
+// required parameters, sorted by pid
+static constexpr RDMPIDEntry builtInPIDs[] = {
+	{ RDM_QUEUED_MESSAGE,         RDM_PID_GET | RDM_PID_LISTED | RDM_PID_ROOT_ONLY, 1, 0, 0, &RDMResponder::builtInHandler },
+	{ RDM_STATUS_MESSAGES,        RDM_PID_GET | RDM_PID_LISTED | RDM_PID_ROOT_ONLY, 1, 0, 0, &RDMResponder::builtInHandler },
+	{ RDM_SUPPORTED_PARAMETERS,   RDM_PID_GET,     0, 0, 0, &RDMResponder::builtInHandler },
+	{ RDM_DEVICE_INFO,            RDM_PID_GET,     0, 0, 0, &RDMResponder::builtInHandler },
+	{ RDM_SOFTWARE_VERSION_LABEL, RDM_PID_GET,     0, 0, 0, &RDMResponder::builtInHandler },
+	{ RDM_DEVICE_START_ADDR,      RDM_PID_GET_SET, 0, 2, 2, &RDMResponder::builtInHandler },
+	{ RDM_IDENTIFY_DEVICE,        RDM_PID_GET_SET, 0, 1, 1, &RDMResponder::builtInHandler }
+};
+RDM_CHECK_PID_TABLE(builtInPIDs);
+
+RDMResponder::RDMResponder ( void ) {
+	_table = NULL;
+	_table_count = 0;
+	_software_label = "";
+	_software_version = 0;
+	_model = 0;
+	_category = 0;
+	_footprint = 1;
+	_start_address = 1;
+	_identify = 0;
+	_subdevices = NULL;
+	_subdevice_count = 0;
+	_sub_model = 0;
+	_sub_footprint = 0;
+	_overflow_pid = 0;
+	_overflow_offset = 0;
+	_overflow_next = 0;
+	_overflow_tn = 0;
+	_packet_pending = 0;
+	_packet_len = 0;
+}
+
+void RDMResponder::begin( const RDMPIDEntry* table, uint16_t count ) {
+	_table = table;
+	_table_count = count;
+	_active = this;
+	SAMD51DMX.setRDMReceivedCallback(&RDMResponder::rdmReceived);
+	SAMD51DMX.setRDMMessageQueue(&_queue);
+	SAMD51DMX.setAutoRDMDiscovery(1);		// answer discovery from ISR, independent of loop()
+}
+
+void RDMResponder::rdmReceived(int len) {
+	if ( _active ) {
+		_active->_packet_len = len;
+		_active->_packet_pending = 1;
+	}
+}
+
+void RDMResponder::setDeviceInfo(uint16_t model, uint16_t category, uint32_t software_version, uint16_t footprint) {
+	_model = model;
+	_category = category;
+	_software_version = software_version;
+	_footprint = footprint;
+}
+
+void RDMResponder::setSoftwareVersionLabel(const char* label) {
+	_software_label = label;
+}
+
+uint16_t RDMResponder::startAddress( void ) {
+	return _start_address;
+}
+
+void RDMResponder::setStartAddress( uint16_t address ) {
+	_start_address = address;
+}
+
+uint8_t RDMResponder::identify( void ) {
+	return _identify;
+}
+
+void RDMResponder::setIdentify( uint8_t identify ) {
+	_identify = identify;
+}
+
+uint8_t RDMResponder::discoveryMuted( void ) {
+	return SAMD51DMX.rdmDiscoveryMuted();
+}
+
+void RDMResponder::setSubDevices( RDMSubDeviceState* states, uint16_t count, uint16_t model, uint16_t footprint ) {
+	if ( count > RDM_MAX_SUB_DEVICES ) {
+		count = RDM_MAX_SUB_DEVICES;
+	}
+	_subdevices = states;
+	_subdevice_count = count;
+	_sub_model = model;
+	_sub_footprint = footprint;
+}
+
+RDMSubDeviceState* RDMResponder::subDevice( uint16_t subdevice ) {
+	if ( ( subdevice == RDM_ROOT_DEVICE ) || ( subdevice > _subdevice_count ) ) {
+		return NULL;
+	}
+	return &_subdevices[subdevice-1];
+}
+
+uint16_t RDMResponder::subDeviceCount( void ) {
+	return _subdevice_count;
+}
+
+RDMMessageQueue* RDMResponder::messageQueue( void ) {
+	return &_queue;
+}
+
+uint8_t RDMResponder::queueParameter( uint16_t pid, uint16_t subdevice ) {
+	const RDMPIDEntry* entry = lookupPID(pid);
+	if ( ( entry == NULL ) || ( ( entry->flags & RDM_PID_GET ) == 0 ) || ( entry->get_pdl != 0 ) ) {
+		return 0;								// only parameters that GET without data
+	}
+	RDMRequest request;
+	request.cmdclass = RDM_GET_COMMAND;
+	request.pid = pid;
+	request.subdevice = subdevice;
+	request.packet = NULL;
+	request.data = NULL;
+	request.pdl = 0;
+	request.response = &SAMD51DMX.rdmData()[24];		// scratch, only used while sending a response
+	request.response_len = 0;
+	request.nack_reason = RDM_NR_UNKNOWN_PID;
+	request.offset = 0;
+	if ( dispatch(entry, &request) != RDM_RESPONSE_TYPE_ACK ) {
+		return 0;
+	}
+	return _queue.queueMessage(RDM_GET_COMMAND_RESPONSE, pid, request.response, request.response_len, subdevice);
+}
+
+/************************************ dispatch ***********************************/
+
+uint8_t RDMResponder::update( void ) {
+	if ( _packet_pending == 0 ) {
+		return 0;
+	}
+	_packet_pending = 0;
+	if ( _packet_len < RDM_PKT_BASE_TOTAL_LEN ) {
+		return 1;
+	}
+
+	uint8_t* packet = SAMD51DMX.receivedRDMData();
+	uint8_t* dest = &packet[RDM_IDX_DESTINATION_UID];
+	uint8_t* uid = LXSAMD51DMX::THIS_DEVICE_ID.rawbytes();
+
+	// raw byte compares, no UID objects needed
+	uint8_t unicast = ( memcmp(dest, uid, 6) == 0 );
+	if ( ! unicast ) {
+		// broadcast to all devices or to all devices with this manufacturer ID
+		if ( ( dest[2] & dest[3] & dest[4] & dest[5] ) != 0xFF ) {
+			return 1;
+		}
+		if ( ( ( dest[0] & dest[1] ) != 0xFF ) && ( ( dest[0] != uid[0] ) || ( dest[1] != uid[1] ) ) ) {
+			return 1;
+		}
+	}
+
+	uint8_t cmdclass = packet[RDM_IDX_CMD_CLASS];
+	uint16_t pid = (packet[RDM_IDX_PID_MSB] << 8) | packet[RDM_IDX_PID_LSB];
+
+	if ( cmdclass == RDM_DISCOVERY_COMMAND ) {
+		handleDiscovery(packet, pid, unicast);
+	} else if ( ( cmdclass == RDM_GET_COMMAND ) || ( cmdclass == RDM_SET_COMMAND ) ) {
+		handleCommand(packet, cmdclass, pid, unicast);
+	}
+	return 1;
+}
+
+void RDMResponder::handleDiscovery(uint8_t* packet, uint16_t pid, uint8_t unicast) {
+	uint8_t* uid = LXSAMD51DMX::THIS_DEVICE_ID.rawbytes();
+
+	if ( pid == RDM_DISC_UNIQUE_BRANCH ) {
+		if ( ( SAMD51DMX.rdmDiscoveryMuted() == 0 ) && ( packet[RDM_IDX_PARAM_DATA_LEN] == RDM_DISC_UNIQUE_BRANCH_PDL ) ) {
+			// UIDs are big endian so memcmp orders them
+			if ( ( memcmp(&packet[24], uid, 6) <= 0 ) && ( memcmp(uid, &packet[30], 6) <= 0 ) ) {
+				SAMD51DMX.sendRDMDiscoverBranchResponse();
+			}
+		}
+	} else if ( ( pid == RDM_DISC_MUTE ) || ( pid == RDM_DISC_UNMUTE ) ) {
+		SAMD51DMX.setRDMDiscoveryMuted( pid == RDM_DISC_MUTE );
+		if ( unicast ) {
+			uint8_t* response = SAMD51DMX.rdmData();
+			response[24] = 0;						// control field
+			response[25] = 0;
+			sendResponse(packet, RDM_RESPONSE_TYPE_ACK, RDM_DISC_COMMAND_RESPONSE, pid, RDM_ROOT_DEVICE, 2);
+		}
+	}
+}
+
+void RDMResponder::handleCommand(uint8_t* packet, uint8_t cmdclass, uint16_t pid, uint8_t unicast) {
+	RDMRequest request;
+	request.cmdclass = cmdclass;
+	request.pid = pid;
+	request.subdevice = (packet[RDM_IDX_SUB_DEV_MSB] << 8) | packet[RDM_IDX_SUB_DEV_LSB];
+	request.packet = packet;
+	request.data = &packet[24];
+	request.pdl = packet[RDM_IDX_PARAM_DATA_LEN];
+	request.response = &SAMD51DMX.rdmData()[24];
+	request.response_len = 0;
+	request.nack_reason = RDM_NR_UNKNOWN_PID;
+	request.offset = 0;
+
+	// continuing an overflow response, same GET from the same controller
+	// a repeated transaction number is a retry and gets the same chunk again
+	uint8_t* controller = &packet[RDM_IDX_SOURCE_UID];
+	uint8_t tn = packet[RDM_IDX_TRANSACTION_NUM];
+	if ( ( cmdclass == RDM_GET_COMMAND ) && ( pid == _overflow_pid ) && ( request.subdevice == _overflow_subdevice )
+	     && ( memcmp(controller, _overflow_controller, 6) == 0 ) ) {
+		request.offset = ( tn == _overflow_tn ) ? _overflow_offset : _overflow_next;
+	}
+	_overflow_pid = 0;
+
+	const RDMPIDEntry* entry = lookupPID(pid);
+	uint8_t rtype;
+
+	if ( request.subdevice == RDM_SUB_DEVICE_ALL_CALL ) {
+		if ( ( cmdclass == RDM_GET_COMMAND ) || ( _subdevice_count == 0 ) ) {
+			rtype = nack(&request, RDM_NR_SUB_DEVICE_OUT_OF_RANGE);
+		} else {									// SET each sub-device, one response
+			for (uint16_t sd=1; sd<=_subdevice_count; sd++) {
+				request.subdevice = sd;
+				rtype = dispatch(entry, &request);
+				if ( rtype != RDM_RESPONSE_TYPE_ACK ) {
+					break;
+				}
+			}
+			request.subdevice = RDM_SUB_DEVICE_ALL_CALL;
+			if ( rtype == RDM_RESPONSE_TYPE_ACK ) {
+				request.response_len = 0;
+			}
+		}
+	} else if ( request.subdevice > _subdevice_count ) {
+		rtype = nack(&request, RDM_NR_SUB_DEVICE_OUT_OF_RANGE);
+	} else {
+		rtype = dispatch(entry, &request);
+	}
+
+	if ( ! unicast ) {							// no responses to broadcast
+		return;
+	}
+
+	// remember each chunk, including the last, so a retry can be answered
+	if ( ( rtype == RDM_RESPONSE_TYPE_ACK_OVERFLOW ) || ( ( rtype == RDM_RESPONSE_TYPE_ACK ) && ( request.offset > 0 ) ) ) {
+		_overflow_pid = pid;
+		_overflow_subdevice = request.subdevice;
+		_overflow_tn = tn;
+		_overflow_offset = request.offset;
+		_overflow_next = ( rtype == RDM_RESPONSE_TYPE_ACK_OVERFLOW ) ? request.offset + request.response_len : 0;
+		memcpy(_overflow_controller, controller, 6);
+	}
+
+	if ( rtype == RDM_RESPONSE_TYPE_NACK_REASON ) {
+		request.response[0] = request.nack_reason >> 8;
+		request.response[1] = request.nack_reason & 0xFF;
+		request.response_len = 2;
+	}
+	// command class 0x20->0x21, 0x30->0x31, response classes set by a handler are unchanged
+	sendResponse(packet, rtype, request.cmdclass | 0x01, request.pid, request.subdevice, request.response_len);
+}
+
+void RDMResponder::sendResponse(uint8_t* packet, uint8_t rtype, uint8_t cmdclass, uint16_t pid, uint16_t subdevice, uint8_t pdl) {
+	uint8_t* response = SAMD51DMX.rdmData();
+
+	// parameter data is already in place at response[24]
+	SAMD51DMX.setupRDMDevicePacket(response, RDM_PKT_BASE_MSG_LEN+pdl, rtype, 0, subdevice);
+	memcpy(&response[RDM_IDX_DESTINATION_UID], &packet[RDM_IDX_SOURCE_UID], 6);
+	response[RDM_IDX_TRANSACTION_NUM] = packet[RDM_IDX_TRANSACTION_NUM];
+	SAMD51DMX.setupRDMMessageDataBlock(response, cmdclass, pid, pdl);
+
+	SAMD51DMX.sendRawRDMPacket(RDM_PKT_BASE_TOTAL_LEN+pdl);
+}
+
+uint8_t RDMResponder::dispatch(const RDMPIDEntry* entry, RDMRequest* request) {
+	if ( entry == NULL ) {
+		return nack(request, RDM_NR_UNKNOWN_PID);
+	}
+	if ( ( entry->flags & RDM_PID_ROOT_ONLY ) && ( request->subdevice != RDM_ROOT_DEVICE ) ) {
+		return nack(request, RDM_NR_SUB_DEVICE_OUT_OF_RANGE);
+	}
+	if ( request->cmdclass == RDM_GET_COMMAND ) {
+		if ( ( entry->flags & RDM_PID_GET ) == 0 ) {
+			return nack(request, RDM_NR_UNSUPPORTED_COMMAND_CLASS);
+		}
+		if ( request->pdl != entry->get_pdl ) {
+			return nack(request, RDM_NR_FORMAT_ERROR);
+		}
+	} else {
+		if ( ( entry->flags & RDM_PID_SET ) == 0 ) {
+			return nack(request, RDM_NR_UNSUPPORTED_COMMAND_CLASS);
+		}
+		if ( ( request->pdl < entry->set_min_pdl ) || ( request->pdl > entry->set_max_pdl ) ) {
+			return nack(request, RDM_NR_FORMAT_ERROR);
+		}
+	}
+	return entry->handler(request);
+}
+
+const RDMPIDEntry* RDMResponder::lookupPID(uint16_t pid) {
+	const RDMPIDEntry* entry = findPID(_table, _table_count, pid);
+	if ( entry == NULL ) {
+		entry = findPID(builtInPIDs, RDM_PID_TABLE_COUNT(builtInPIDs), pid);
+	}
+	return entry;
+}
+
+const RDMPIDEntry* RDMResponder::findPID(const RDMPIDEntry* table, uint16_t count, uint16_t pid) {
+	uint16_t lo = 0;
+	uint16_t hi = count;
+	while ( lo < hi ) {
+		uint16_t mid = (lo + hi) >> 1;
+		if ( table[mid].pid < pid ) {
+			lo = mid + 1;
+		} else if ( table[mid].pid > pid ) {
+			hi = mid;
+		} else {
+			return &table[mid];
+		}
+	}
+	return NULL;
+}
+
+/************************************ handler utilities ***********************************/
+
+uint8_t RDMResponder::ackWithData(RDMRequest* request, const uint8_t* data, uint8_t len) {
+	if ( len > RDM_MAX_PDL ) {
+		len = RDM_MAX_PDL;
+	}
+	memcpy(request->response, data, len);
+	request->response_len = len;
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+uint8_t RDMResponder::ackWithLargeData(RDMRequest* request, const uint8_t* data, uint16_t len) {
+	if ( request->offset >= len ) {
+		request->response_len = 0;
+		return RDM_RESPONSE_TYPE_ACK;
+	}
+	uint16_t remaining = len - request->offset;
+	if ( remaining > RDM_MAX_PDL ) {
+		memcpy(request->response, &data[request->offset], RDM_MAX_PDL);
+		request->response_len = RDM_MAX_PDL;
+		return RDM_RESPONSE_TYPE_ACK_OVERFLOW;
+	}
+	memcpy(request->response, &data[request->offset], remaining);
+	request->response_len = remaining;
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+uint8_t RDMResponder::ackTimer(RDMRequest* request, uint16_t tenths) {
+	request->response[0] = tenths >> 8;
+	request->response[1] = tenths & 0xFF;
+	request->response_len = 2;
+	return RDM_RESPONSE_TYPE_ACK_TIMER;
+}
+
+uint8_t RDMResponder::ackWithLabel(RDMRequest* request, const char* label) {
+	size_t len = strlen(label);
+	if ( len > RDM_SOFTWARE_LABEL_MAX ) {
+		len = RDM_SOFTWARE_LABEL_MAX;
+	}
+	return ackWithData(request, (const uint8_t*)label, len);
+}
+
+uint8_t RDMResponder::nack(RDMRequest* request, uint16_t reason) {
+	request->nack_reason = reason;
+	return RDM_RESPONSE_TYPE_NACK_REASON;
+}
+
+/************************************ required parameters ***********************************/
+
+uint8_t RDMResponder::builtInHandler(RDMRequest* request) {
+	switch ( request->pid ) {
+		case RDM_SUPPORTED_PARAMETERS:
+			return _active->getSupportedParameters(request);
+		case RDM_DEVICE_INFO:
+			return _active->getDeviceInfo(request);
+		case RDM_SOFTWARE_VERSION_LABEL:
+			return _active->getSoftwareVersionLabel(request);
+		case RDM_DEVICE_START_ADDR:
+			return _active->startAddressCommand(request);
+		case RDM_IDENTIFY_DEVICE:
+			return _active->identifyCommand(request);
+		case RDM_QUEUED_MESSAGE:
+			return _active->getQueuedMessage(request);
+		case RDM_STATUS_MESSAGES:
+			return _active->getStatusMessages(request);
+	}
+	return nack(request, RDM_NR_UNKNOWN_PID);
+}
+
+uint8_t RDMResponder::getDeviceInfo(RDMRequest* request) {
+	uint16_t model = _model;
+	uint16_t footprint = _footprint;
+	uint16_t address = _start_address;
+	uint16_t subdevices = _subdevice_count;
+	RDMSubDeviceState* state = subDevice(request->subdevice);
+	if ( state ) {
+		model = _sub_model;
+		footprint = _sub_footprint;
+		address = state->start_address;
+		subdevices = 0;
+	}
+	uint8_t* r = request->response;
+	r[0] = RDM_PROTOCOL_VERSION >> 8;
+	r[1] = RDM_PROTOCOL_VERSION & 0xFF;
+	r[2] = model >> 8;
+	r[3] = model & 0xFF;
+	r[4] = _category >> 8;
+	r[5] = _category & 0xFF;
+	r[6] = _software_version >> 24;
+	r[7] = (_software_version >> 16) & 0xFF;
+	r[8] = (_software_version >> 8) & 0xFF;
+	r[9] = _software_version & 0xFF;
+	r[10] = footprint >> 8;
+	r[11] = footprint & 0xFF;
+	r[12] = 1;									// current personality
+	r[13] = 1;									// personality count
+	r[14] = address >> 8;
+	r[15] = address & 0xFF;
+	r[16] = subdevices >> 8;
+	r[17] = subdevices & 0xFF;
+	r[18] = 0;									// sensor count
+	request->response_len = RDM_DEVICE_INFO_PDL;
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+uint8_t RDMResponder::getSupportedParameters(RDMRequest* request) {
+	// list is generated without a buffer, skipping PIDs already sent in earlier overflow responses
+	uint16_t skip = request->offset / 2;
+	uint8_t len = 0;
+	uint16_t count = RDM_PID_TABLE_COUNT(builtInPIDs) + _table_count;
+	for (uint16_t j=0; j<count; j++) {
+		uint16_t pid;
+		if ( j < RDM_PID_TABLE_COUNT(builtInPIDs) ) {
+			if ( ( builtInPIDs[j].flags & RDM_PID_LISTED ) == 0 ) {
+				continue;
+			}
+			if ( ( builtInPIDs[j].flags & RDM_PID_ROOT_ONLY ) && ( request->subdevice != RDM_ROOT_DEVICE ) ) {
+				continue;
+			}
+			pid = builtInPIDs[j].pid;
+		} else {
+			pid = _table[j-RDM_PID_TABLE_COUNT(builtInPIDs)].pid;
+			// required parameters are not listed, listed built-ins were already
+			if ( findPID(builtInPIDs, RDM_PID_TABLE_COUNT(builtInPIDs), pid) ) {
+				continue;
+			}
+		}
+		if ( skip ) {
+			skip--;
+		} else if ( len + 2 > RDM_MAX_PDL ) {
+			request->response_len = len;
+			return RDM_RESPONSE_TYPE_ACK_OVERFLOW;
+		} else {
+			request->response[len++] = pid >> 8;
+			request->response[len++] = pid & 0xFF;
+		}
+	}
+	request->response_len = len;
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+uint8_t RDMResponder::getSoftwareVersionLabel(RDMRequest* request) {
+	return ackWithLabel(request, _software_label);
+}
+
+uint8_t RDMResponder::startAddressCommand(RDMRequest* request) {
+	uint16_t* start_address = &_start_address;
+	RDMSubDeviceState* state = subDevice(request->subdevice);
+	if ( state ) {
+		start_address = &state->start_address;
+	}
+	if ( request->cmdclass == RDM_GET_COMMAND ) {
+		request->response[0] = *start_address >> 8;
+		request->response[1] = *start_address & 0xFF;
+		request->response_len = 2;
+		return RDM_RESPONSE_TYPE_ACK;
+	}
+	uint16_t address = (request->data[0] << 8) | request->data[1];
+	if ( ( address == 0 ) || ( address > DMX_MAX_SLOTS ) ) {
+		return nack(request, RDM_NR_DATA_OUT_OF_RANGE);
+	}
+	*start_address = address;
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+uint8_t RDMResponder::identifyCommand(RDMRequest* request) {
+	uint8_t* identify = &_identify;
+	RDMSubDeviceState* state = subDevice(request->subdevice);
+	if ( state ) {
+		identify = &state->identify;
+	}
+	if ( request->cmdclass == RDM_GET_COMMAND ) {
+		request->response[0] = *identify;
+		request->response_len = 1;
+		return RDM_RESPONSE_TYPE_ACK;
+	}
+	if ( request->data[0] > 1 ) {
+		return nack(request, RDM_NR_DATA_OUT_OF_RANGE);
+	}
+	*identify = request->data[0];
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+uint8_t RDMResponder::getQueuedMessage(RDMRequest* request) {
+	uint8_t type = request->data[0];
+	if ( type > RDM_STATUS_ERROR ) {
+		return nack(request, RDM_NR_DATA_OUT_OF_RANGE);
+	}
+	const RDMQueuedMessage* msg;
+	if ( type == RDM_STATUS_GET_LAST_MESSAGE ) {
+		msg = _queue.last();
+	} else {
+		msg = _queue.next();
+	}
+	if ( msg == NULL ) {						// nothing queued, answer with status messages
+		request->pid = RDM_STATUS_MESSAGES;
+		return getStatusMessages(request);
+	}
+	request->cmdclass = msg->cmdclass;
+	request->pid = msg->pid;
+	request->subdevice = msg->subdevice;
+	return ackWithData(request, msg->data, msg->pdl);
+}
+
+uint8_t RDMResponder::getStatusMessages(RDMRequest* request) {
+	uint8_t type = request->data[0];
+	if ( type > RDM_STATUS_ERROR ) {
+		return nack(request, RDM_NR_DATA_OUT_OF_RANGE);
+	}
+	request->response_len = _queue.statusMessages(type, request->response, RDM_MAX_PDL);
+	return RDM_RESPONSE_TYPE_ACK;
+}
+
+#endif	// LXSAMD51DMX_RDM
@@ -0,0 +1,286 @@
+/**************************************************************************/
+/*!
+    @file     RDMResponder.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    Implements an RDM responder that dispatches GET and SET commands
+    through a sorted table of parameter handlers
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef RDMResponder_h
+#define RDMResponder_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <LXSAMD51DMX.h>
+#include <rdm/rdm_utility.h>
+#include <rdm/UID.h>
+#include <rdm/RDMMessageQueue.h>
+
+// RDMPIDEntry flags
+#define RDM_PID_GET		0x01
+#define RDM_PID_SET		0x02
+#define RDM_PID_GET_SET	0x03
+#define RDM_PID_LISTED	0x04		// built-in parameter reported in SUPPORTED_PARAMETERS
+#define RDM_PID_ROOT_ONLY	0x08	// sub-device requests are NACKed with RDM_NR_SUB_DEVICE_OUT_OF_RANGE
+
+#define RDM_SOFTWARE_LABEL_MAX	32
+
+/*!
+ * @brief a GET or SET command passed to a parameter handler
+ * @discussion The handler writes parameter data for the response directly into response
+ *             (up to RDM_MAX_PDL bytes), sets response_len and returns a response type.
+ *             If it returns RDM_RESPONSE_TYPE_NACK_REASON, it sets nack_reason.
+ *             cmdclass, pid and subdevice are also used for the response.  A handler answering
+ *             for another parameter, as QUEUED_MESSAGE does, may change them.
+ *             For GET, offset is the position in the parameter data where this response starts.
+ *             It is non-zero when the controller continues after RDM_RESPONSE_TYPE_ACK_OVERFLOW.
+ */
+typedef struct {
+	uint8_t  cmdclass;
+	uint16_t pid;
+	uint16_t subdevice;
+	uint8_t* packet;			// the complete received packet
+	uint8_t* data;				// request parameter data
+	uint8_t  pdl;
+	uint8_t* response;			// response parameter data
+	uint8_t  response_len;
+	uint16_t nack_reason;
+	uint16_t offset;
+} RDMRequest;
+
+typedef uint8_t (*RDMPIDHandler)(RDMRequest* request);
+
+/*!
+ * @brief entry in a table of parameters supported by a responder
+ * @discussion get_pdl is the exact PDL accepted for GET,
+ *             set_min_pdl/set_max_pdl the range accepted for SET.
+ *             A table must be sorted by pid. Declare it constexpr and use
+ *             RDM_CHECK_PID_TABLE to have the compiler verify the order.
+ */
+typedef struct {
+	uint16_t      pid;
+	uint8_t       flags;
+	uint8_t       get_pdl;
+	uint8_t       set_min_pdl;
+	uint8_t       set_max_pdl;
+	RDMPIDHandler handler;
+} RDMPIDEntry;
+
+/*!
+ * @brief state of one sub-device, kept in an array supplied to RDMResponder::setSubDevices
+ * @discussion sub-device n is at index n-1
+ */
+typedef struct {
+	uint16_t start_address;
+	uint8_t  identify;
+	uint8_t  user;				// free for the application
+} RDMSubDeviceState;
+
+template <size_t N>
+constexpr bool rdmPIDTableSorted(const RDMPIDEntry (&table)[N], size_t i = 1) {
+	return ( i >= N ) ? true : ( ( table[i-1].pid < table[i].pid ) && rdmPIDTableSorted(table, i+1) );
+}
+
+#define RDM_PID_TABLE_COUNT(table) (sizeof(table)/sizeof(RDMPIDEntry))
+#define RDM_CHECK_PID_TABLE(table) static_assert(rdmPIDTableSorted(table), #table " must be sorted by pid")
+
+/*!
+@class RDMResponder
+@abstract
+   RDMResponder answers RDM commands addressed to LXSAMD51DMX::THIS_DEVICE_ID.
+
+   DISC_UNIQUE_BRANCH, DISC_MUTE and DISC_UNMUTE are answered by SAMD51DMX from its interrupt handler
+   (see LXSAMD51DMX::setAutoRDMDiscovery) so discovery does not depend on how often update() is called.
+   Also handled automatically are the required parameters DEVICE_INFO, SUPPORTED_PARAMETERS, SOFTWARE_VERSION_LABEL,
+   DMX_START_ADDRESS and IDENTIFY_DEVICE plus QUEUED_MESSAGE and STATUS_MESSAGES.  Other parameters are looked up with a binary search
+   of the table passed to begin().  A table entry for a required parameter replaces the built-in one.
+
+   Sub-devices 1 to count are enabled with setSubDevices().  Their state is found by indexing
+   the array supplied, the built-in parameters answer for them and handlers see the sub-device
+   in RDMRequest.  A SET to all sub-devices (0xFFFF) calls the handler once for each.
+
+   Call update() from loop() to process RDM packets received by SAMD51DMX.
+*/
+
+class RDMResponder {
+
+  public:
+
+	RDMResponder  ( void );
+
+	/*!
+	 * @brief sets the parameter table and the SAMD51DMX RDM received callback, enables auto discovery
+	 * @discussion set LXSAMD51DMX::THIS_DEVICE_ID before calling begin()
+	 * @param table parameter handlers sorted by pid (may be NULL)
+	 * @param count number of entries in table
+	 */
+	void begin( const RDMPIDEntry* table, uint16_t count );
+
+	/*!
+	 * @brief processes an RDM packet if one has been received
+	 * @return 1 if a packet was processed
+	 */
+	uint8_t update( void );
+
+	/*!
+	 * @brief fields reported by DEVICE_INFO
+	 */
+	void setDeviceInfo(uint16_t model, uint16_t category, uint32_t software_version, uint16_t footprint);
+
+	/*!
+	 * @brief label returned for SOFTWARE_VERSION_LABEL (up to 32 characters, not copied)
+	 */
+	void setSoftwareVersionLabel(const char* label);
+
+	uint16_t startAddress( void );
+	void     setStartAddress( uint16_t address );
+
+	/*!
+	 * @brief state of IDENTIFY_DEVICE
+	 * @return 1 if the device should identify itself
+	 */
+	uint8_t  identify( void );
+	void     setIdentify( uint8_t identify );
+
+	/*!
+	 * @brief enables sub-devices 1 to count
+	 * @param states array of count entries, not copied
+	 * @param model, footprint reported by DEVICE_INFO for every sub-device
+	 */
+	void     setSubDevices( RDMSubDeviceState* states, uint16_t count, uint16_t model, uint16_t footprint );
+
+	/*!
+	 * @brief state of a sub-device
+	 * @return NULL if subdevice is not 1 to count
+	 */
+	RDMSubDeviceState* subDevice( uint16_t subdevice );
+	uint16_t subDeviceCount( void );
+
+	/*!
+	 * @brief discovery mute flag, set by DISC_MUTE and cleared by DISC_UNMUTE
+	 */
+	uint8_t  discoveryMuted( void );
+
+	/*!
+	 * @brief queued and status messages collected by the controller
+	 */
+	RDMMessageQueue* messageQueue( void );
+
+	/*!
+	 * @brief queues the current value of a parameter so a controller polling QUEUED_MESSAGE sees the change
+	 * @discussion calls the parameter's GET handler, the value must fit in RDM_QUEUE_MAX_PDL
+	 * @return 1 if the value was queued
+	 */
+	uint8_t queueParameter( uint16_t pid, uint16_t subdevice=RDM_ROOT_DEVICE );
+
+	/*!
+	 * @brief copies data into the response and returns RDM_RESPONSE_TYPE_ACK
+	 */
+	static uint8_t ackWithData(RDMRequest* request, const uint8_t* data, uint8_t len);
+
+	/*!
+	 * @brief copies the part of data starting at request->offset into the response
+	 * @return RDM_RESPONSE_TYPE_ACK_OVERFLOW if more remains to be sent, otherwise RDM_RESPONSE_TYPE_ACK
+	 */
+	static uint8_t ackWithLargeData(RDMRequest* request, const uint8_t* data, uint16_t len);
+
+	/*!
+	 * @brief defers the response, sets the estimated time until it is queued
+	 * @discussion When ready, add the response to messageQueue() (or use queueParameter)
+	 *             where the controller collects it with QUEUED_MESSAGE.
+	 * @param tenths estimated time in 100ms units
+	 * @return RDM_RESPONSE_TYPE_ACK_TIMER
+	 */
+	static uint8_t ackTimer(RDMRequest* request, uint16_t tenths);
+
+	/*!
+	 * @brief copies a zero terminated label (max 32 characters) into the response, returns RDM_RESPONSE_TYPE_ACK
+	 */
+	static uint8_t ackWithLabel(RDMRequest* request, const char* label);
+
+	/*!
+	 * @brief sets the nack reason and returns RDM_RESPONSE_TYPE_NACK_REASON
+	 */
+	static uint8_t nack(RDMRequest* request, uint16_t reason);
+
+	/*!
+	 * @brief RDM received callback installed by begin()
+	 */
+	static void rdmReceived(int len);
+
+	/*!
+	 * @brief handler for the required parameters in the built-in table
+	 */
+	static uint8_t builtInHandler(RDMRequest* request);
+
+  private:
+
+	/*!
+	 * @brief binary search of a sorted table
+	 */
+	static const RDMPIDEntry* findPID(const RDMPIDEntry* table, uint16_t count, uint16_t pid);
+
+	void    handleDiscovery(uint8_t* packet, uint16_t pid, uint8_t unicast);
+	void    handleCommand(uint8_t* packet, uint8_t cmdclass, uint16_t pid, uint8_t unicast);
+	uint8_t dispatch(const RDMPIDEntry* entry, RDMRequest* request);
+	void    sendResponse(uint8_t* packet, uint8_t rtype, uint8_t cmdclass, uint16_t pid, uint16_t subdevice, uint8_t pdl);
+	const RDMPIDEntry* lookupPID(uint16_t pid);
+
+	uint8_t getDeviceInfo(RDMRequest* request);
+	uint8_t getSupportedParameters(RDMRequest* request);
+	uint8_t getSoftwareVersionLabel(RDMRequest* request);
+	uint8_t startAddressCommand(RDMRequest* request);
+	uint8_t identifyCommand(RDMRequest* request);
+	uint8_t getQueuedMessage(RDMRequest* request);
+	uint8_t getStatusMessages(RDMRequest* request);
+
+	const RDMPIDEntry* _table;
+	uint16_t           _table_count;
+
+	const char*        _software_label;
+	uint32_t           _software_version;
+	uint16_t           _model;
+	uint16_t           _category;
+	uint16_t           _footprint;
+	uint16_t           _start_address;
+	uint8_t            _identify;
+
+	RDMSubDeviceState* _subdevices;
+	uint16_t           _subdevice_count;
+	uint16_t           _sub_model;
+	uint16_t           _sub_footprint;
+
+	RDMMessageQueue    _queue;
+
+	/*!
+	 * @brief GET being continued with ACK_OVERFLOW, pid is zero if none
+	 * @discussion _overflow_offset is the start of the chunk sent for _overflow_tn,
+	 *             _overflow_next the start of the following chunk (zero after the last)
+	 */
+	uint16_t           _overflow_pid;
+	uint16_t           _overflow_subdevice;
+	uint16_t           _overflow_offset;
+	uint16_t           _overflow_next;
+	uint8_t            _overflow_tn;
+	uint8_t            _overflow_controller[6];
+
+	/*!
+	 * @brief set by rdmReceived for update(), with the length of the packet including checksum
+	 */
+	volatile uint8_t   _packet_pending;
+	volatile uint16_t  _packet_len;
+
+	static RDMResponder* _active;
+};
+
+#endif	//RDMResponder_h
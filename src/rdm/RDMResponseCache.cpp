@@ -0,0 +1,125 @@
+/**************************************************************************/
+/*!
+    @file     RDMResponseCache.cpp
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include <Arduino.h>
+#include <rdm/RDMResponseCache.h>
+
+RDMResponseCache::RDMResponseCache ( void ) {
+	reset();
+}
+
+void RDMResponseCache::reset( void ) {
+	for (uint8_t j=0; j<RDM_CACHE_ENTRIES; j++) {
+		_entries[j].valid = 0;
+	}
+	_stamp = 0;
+	_hits = 0;
+	_misses = 0;
+}
+
+uint8_t RDMResponseCache::cacheable( uint16_t pid ) {
+	switch ( pid ) {
+		case RDM_SUPPORTED_PARAMETERS:
+		case RDM_DEVICE_INFO:
+		case RDM_DEVICE_MODEL_DESC:
+		case RDM_DEVICE_MFG_LABEL:
+		case RDM_SOFTWARE_VERSION_LABEL:
+			return 1;
+	}
+	return 0;
+}
+
+RDMCacheEntry* RDMResponseCache::find(UID* target, uint16_t pid, uint16_t subdevice) {
+	for (uint8_t j=0; j<RDM_CACHE_ENTRIES; j++) {
+		RDMCacheEntry* entry = &_entries[j];
+		if ( entry->valid && ( entry->pid == pid ) && ( entry->subdevice == subdevice ) && ( *target == entry->uid ) ) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+uint8_t RDMResponseCache::get(UID* target, uint16_t pid, uint16_t subdevice, uint8_t* data, uint16_t len, uint16_t* pdl) {
+	if ( ! cacheable(pid) ) {
+		return 0;
+	}
+	RDMCacheEntry* entry = find(target, pid, subdevice);
+	if ( entry == NULL ) {
+		_misses++;
+		return 0;
+	}
+	entry->stamp = ++_stamp;
+	memcpy(data, entry->data, ( entry->pdl < len ) ? entry->pdl : len);
+	if ( pdl ) {
+		*pdl = entry->pdl;
+	}
+	_hits++;
+	return 1;
+}
+
+void RDMResponseCache::store(UID* target, uint16_t pid, uint16_t subdevice, const uint8_t* data, uint8_t pdl) {
+	if ( ( ! cacheable(pid) ) || ( pdl > RDM_CACHE_MAX_PDL ) ) {
+		return;
+	}
+	RDMCacheEntry* entry = find(target, pid, subdevice);
+	if ( entry == NULL ) {							// use a free slot or the least recently used
+		entry = &_entries[0];
+		for (uint8_t j=0; ( j<RDM_CACHE_ENTRIES ) && entry->valid; j++) {
+			RDMCacheEntry* e = &_entries[j];
+			if ( ( ! e->valid ) || ( (uint16_t)(_stamp - e->stamp) > (uint16_t)(_stamp - entry->stamp) ) ) {
+				entry = e;
+			}
+		}
+		UID::copyFromUID(*target, entry->uid);
+		entry->pid = pid;
+		entry->subdevice = subdevice;
+	}
+	entry->pdl = pdl;
+	memcpy(entry->data, data, pdl);
+	entry->stamp = ++_stamp;
+	entry->valid = 1;
+}
+
+uint8_t RDMResponseCache::addressed(UID* target, const uint8_t* uid) {
+	uint8_t* dest = target->rawbytes();
+	if ( ( dest[2] & dest[3] & dest[4] & dest[5] ) == 0xFF ) {		// broadcast to all or to a manufacturer
+		return ( ( dest[0] & dest[1] ) == 0xFF ) || ( ( dest[0] == uid[0] ) && ( dest[1] == uid[1] ) );
+	}
+	return ( memcmp(dest, uid, 6) == 0 );
+}
+
+void RDMResponseCache::invalidate( UID* target ) {
+	for (uint8_t j=0; j<RDM_CACHE_ENTRIES; j++) {
+		if ( addressed(target, _entries[j].uid) ) {
+			_entries[j].valid = 0;
+		}
+	}
+}
+
+void RDMResponseCache::invalidate( UID* target, uint16_t pid ) {
+	for (uint8_t j=0; j<RDM_CACHE_ENTRIES; j++) {
+		if ( ( _entries[j].pid == pid ) && addressed(target, _entries[j].uid) ) {
+			_entries[j].valid = 0;
+		}
+	}
+}
+
+uint32_t RDMResponseCache::hits( void ) {
+	return _hits;
+}
+
+uint32_t RDMResponseCache::misses( void ) {
+	return _misses;
+}
@@ -0,0 +1,114 @@
+/**************************************************************************/
+/*!
+    @file     RDMResponseCache.h
+    @author   Claude Heintz
+    @license  BSD (see LXSAMD51DMX.h)
+    @copyright 2021 by Claude Heintz
+
+    RDM support for DMX Driver for SAMD51
+
+    Implements a cache of GET responses for parameters that do not change
+    in a fixed number of slots replaced least recently used first
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#ifndef RDMResponseCache_h
+#define RDMResponseCache_h
+
+#include <stdint.h>
+#include <rdm/rdm_utility.h>
+#include <rdm/UID.h>
+
+// number of cached responses
+#define RDM_CACHE_ENTRIES		16
+// largest parameter data cached (labels are 32)
+#define RDM_CACHE_MAX_PDL		32
+
+/*!
+ * @brief a cached response, stamp orders entries by last use
+ */
+typedef struct {
+	uint8_t  uid[6];
+	uint16_t pid;
+	uint16_t subdevice;
+	uint16_t stamp;
+	uint8_t  valid;
+	uint8_t  pdl;
+	uint8_t  data[RDM_CACHE_MAX_PDL];
+} RDMCacheEntry;
+
+/*!
+@class RDMResponseCache
+@abstract
+   RDMResponseCache keeps GET responses for parameters that describe a device
+   and do not change while it is on the line: DEVICE_INFO, SUPPORTED_PARAMETERS,
+   DEVICE_MODEL_DESCRIPTION, MANUFACTURER_LABEL and SOFTWARE_VERSION_LABEL.
+
+   Once attached with LXSAMD51DMX::setRDMResponseCache(), sendRDMGetCommand answers these
+   from the cache without using the line.  Use refreshRDMGetCommand to ask the device again.
+   A SET to a device removes its DEVICE_INFO, which reports the start address and personality.
+   
+   When full, the least recently used entry is replaced.  Call invalidate() when a device
+   is removed from the table of devices.
+*/
+
+class RDMResponseCache {
+
+  public:
+
+	RDMResponseCache ( void );
+
+	/*!
+	 * @brief 1 if responses for pid are kept
+	 */
+	static uint8_t cacheable( uint16_t pid );
+
+	/*!
+	 * @brief copies up to len bytes of a cached response into data
+	 * @param pdl (optional, may be NULL) length of the cached response
+	 * @return 1 if found
+	 */
+	uint8_t get(UID* target, uint16_t pid, uint16_t subdevice, uint8_t* data, uint16_t len, uint16_t* pdl);
+
+	/*!
+	 * @brief adds or replaces a response, ignored if pid is not cacheable or pdl is too large
+	 */
+	void    store(UID* target, uint16_t pid, uint16_t subdevice, const uint8_t* data, uint8_t pdl);
+
+	/*!
+	 * @brief removes all responses from target, a broadcast UID removes those of every device it addresses
+	 */
+	void    invalidate( UID* target );
+
+	/*!
+	 * @brief removes responses for pid from target, all sub-devices
+	 */
+	void    invalidate( UID* target, uint16_t pid );
+
+	/*!
+	 * @brief removes all responses and clears counts
+	 */
+	void    reset( void );
+
+	/*!
+	 * @brief number of GETs answered from the cache and number sent to a device
+	 */
+	uint32_t hits( void );
+	uint32_t misses( void );
+
+  private:
+
+	RDMCacheEntry* find(UID* target, uint16_t pid, uint16_t subdevice);
+	static uint8_t addressed(UID* target, const uint8_t* uid);
+
+	RDMCacheEntry  _entries[RDM_CACHE_ENTRIES];
+	uint16_t       _stamp;
+	uint32_t       _hits;
+	uint32_t       _misses;
+};
+
+#endif	//RDMResponseCache_h
@@ -13,6 +13,7 @@
 */
 /**************************************************************************/
 #include <rdm/rdm_utility.h>
+#include <string.h>
 
 uint16_t rdmChecksum(uint8_t* bytes, uint8_t len) {
 	uint16_t rv = 0;
@@ -22,6 +23,34 @@ uint16_t rdmChecksum(uint8_t* bytes, uint8_t len) {
 	return rv;
 }
 
+uint16_t rdmChecksumBulk(const uint8_t* bytes, uint16_t len) {
+	uint32_t rv = 0;
+	uint32_t lanes = 0;
+	uint32_t w;
+	uint8_t words = 0;
+	
+	while ( len && ( (uintptr_t)bytes & 0x3 ) ) {	// leading bytes until word aligned
+		rv += *bytes++;
+		len--;
+	}
+	while ( len >= 4 ) {
+		memcpy(&w, bytes, 4);						// aligned, compiles to a single load
+		lanes += (w & 0x00FF00FF) + ((w >> 8) & 0x00FF00FF);	// two 16 bit lanes
+		bytes += 4;
+		len -= 4;
+		if ( ++words == 128 ) {						// fold before a lane can overflow
+			rv += (lanes & 0xFFFF) + (lanes >> 16);
+			lanes = 0;
+			words = 0;
+		}
+	}
+	rv += (lanes & 0xFFFF) + (lanes >> 16);
+	while ( len-- ) {
+		rv += *bytes++;
+	}
+	return rv & 0xFFFF;
+}
+
 uint8_t testRDMChecksum(uint16_t cksum, uint8_t* data, uint8_t index) {
 	return (( (cksum >> 8) == data[index] ) && ( (cksum &0xFF) == data[index+1] ));
 }
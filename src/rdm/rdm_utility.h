@@ -79,15 +79,44 @@ extern "C" {
 
 
 // response types
-#define RDM_RESPONSE_TYPE_ACK		0x00
+#define RDM_RESPONSE_TYPE_ACK			0x00
+#define RDM_RESPONSE_TYPE_ACK_TIMER		0x01
+#define RDM_RESPONSE_TYPE_NACK_REASON	0x02
+#define RDM_RESPONSE_TYPE_ACK_OVERFLOW	0x03
+
+// NACK reason codes
+#define RDM_NR_UNKNOWN_PID					0x0000
+#define RDM_NR_FORMAT_ERROR					0x0001
+#define RDM_NR_HARDWARE_FAULT				0x0002
+#define RDM_NR_PROXY_REJECT					0x0003
+#define RDM_NR_WRITE_PROTECT				0x0004
+#define RDM_NR_UNSUPPORTED_COMMAND_CLASS	0x0005
+#define RDM_NR_DATA_OUT_OF_RANGE			0x0006
+#define RDM_NR_BUFFER_FULL					0x0007
+#define RDM_NR_PACKET_SIZE_UNSUPPORTED		0x0008
+#define RDM_NR_SUB_DEVICE_OUT_OF_RANGE		0x0009
 
 // discovery-network management Parameter IDs (PID)
 #define RDM_DISC_UNIQUE_BRANCH	0x0001
 #define RDM_DISC_MUTE			0x0002
 #define RDM_DISC_UNMUTE			0x0003
 
+// status collection PIDs
+#define RDM_QUEUED_MESSAGE		0x0020
+#define RDM_STATUS_MESSAGES		0x0030
+
+// status types
+#define RDM_STATUS_NONE					0x00
+#define RDM_STATUS_GET_LAST_MESSAGE		0x01
+#define RDM_STATUS_ADVISORY				0x02
+#define RDM_STATUS_WARNING				0x03
+#define RDM_STATUS_ERROR				0x04
+
 // product information  PIDs
+#define RDM_SUPPORTED_PARAMETERS	0x0050
+#define RDM_PARAMETER_DESCRIPTION	0x0051
 #define RDM_DEVICE_INFO			0x0060
+#define RDM_SOFTWARE_VERSION_LABEL	0x00C0
 #define RDM_DEVICE_START_ADDR	0x00F0
 #define RDM_DEVICE_MODEL_DESC   0x0080
 #define RDM_DEVICE_MFG_LABEL    0x0081
@@ -99,6 +128,15 @@ extern "C" {
 // packet heading constants
 #define RDM_PORT_ONE				0x01
 #define RDM_ROOT_DEVICE				0x0000
+#define RDM_SUB_DEVICE_ALL_CALL		0xFFFF
+#define RDM_MAX_SUB_DEVICES			0x0200
+
+// maximum parameter data length
+#define RDM_MAX_PDL					0xE7
+
+// DEVICE_INFO
+#define RDM_PROTOCOL_VERSION		0x0100
+#define RDM_DEVICE_INFO_PDL			0x13
 
 // RDM packet byte indexes
 #define RDM_IDX_START_CODE				0
@@ -143,6 +181,13 @@ extern "C" {
  */
 uint16_t rdmChecksum(uint8_t* bytes, uint8_t len);
 
+/*
+ *  rdmChecksumBulk calculates the same mod 0x10000 sum as rdmChecksum
+ *  for buffers of any length, adding four bytes at a time
+ *
+ */
+uint16_t rdmChecksumBulk(const uint8_t* bytes, uint16_t len);
+
 /*
  *  testRDMChecksum evaluates cksum and returns true if both
  *	bytes[index]   == cksum[MSB]